@@ -0,0 +1,73 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "alloc_stats.h"
+#include <stddef.h>
+
+// the linker only defines the __real_ symbols when wrapping; weak references keep plain links working
+void* __real_malloc(size_t size) __attribute__((weak));
+void* __real_calloc(size_t count, size_t size) __attribute__((weak));
+void* __real_realloc(void* ptr, size_t size) __attribute__((weak));
+void __real_free(void* ptr) __attribute__((weak));
+
+// per thread: no locking, and the game loop doesn't see what loader threads allocate
+static __thread alloc_stats_t stats;
+
+void* __wrap_malloc(size_t size)
+{
+    stats.allocations++;
+    stats.bytes += size;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+    stats.allocations++;
+    stats.bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+    stats.allocations++;
+    stats.bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void* ptr)
+{
+    if (ptr != NULL) {
+        stats.frees++;
+    }
+    __real_free(ptr);
+}
+
+alloc_stats_t alloc_stats_get(void)
+{
+    return stats;
+}
+
+int alloc_stats_enabled(void)
+{
+    return __real_malloc != NULL;
+}
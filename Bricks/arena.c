@@ -0,0 +1,86 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "arena.h"
+#include <malloc.h>
+#include <string.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+#define ARENA_BLOCK_HEADER ARENA_ALIGN(sizeof(arena_block_t))
+
+static arena_block_t* arena_block_create(size_t size);
+
+arena_t* arena_create(size_t block_size)
+{
+    arena_t* arena = malloc(sizeof(arena_t));
+    arena->block_size = block_size;
+    arena->first = arena_block_create(block_size);
+    arena->current = arena->first;
+    return arena;
+}
+
+void arena_destroy(arena_t* arena)
+{
+    if (arena == NULL)
+        return;
+    arena_block_t* block = arena->first;
+    while (block != NULL) {
+        arena_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void* arena_alloc(arena_t* arena, size_t size)
+{
+    size = ARENA_ALIGN(size == 0 ? 1 : size);
+    arena_block_t* block = arena->current;
+    while (block->size - block->used < size) {
+        if (block->next == NULL) {
+            block->next = arena_block_create(size > arena->block_size ? size : arena->block_size);
+        }
+        block = block->next;
+    }
+    arena->current = block;
+    void* ptr = (char*)block + ARENA_BLOCK_HEADER + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void* arena_alloc_zeroed(arena_t* arena, size_t size)
+{
+    void* ptr = arena_alloc(arena, size);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+static arena_block_t* arena_block_create(size_t size)
+{
+    arena_block_t* block = malloc(ARENA_BLOCK_HEADER + size);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
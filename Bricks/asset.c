@@ -0,0 +1,123 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "asset.h"
+#include "types.h"
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+asset_pack_t* asset_pack_create(const void* data, size_t size)
+{
+    asset_pack_header_t header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "Asset pack is truncated!\n");
+        return NULL;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ASSET_PACK_MAGIC, 4) != 0 || header.version != ASSET_PACK_VERSION || header.header_size != sizeof(header)) {
+        fprintf(stderr, "Unsupported asset pack!\n");
+        return NULL;
+    }
+    if ((size - sizeof(header)) / sizeof(asset_pack_entry_t) < header.entry_count) {
+        fprintf(stderr, "Asset pack index is truncated!\n");
+        return NULL;
+    }
+    const asset_pack_entry_t* entries = (const asset_pack_entry_t*)((const unsigned char*)data + sizeof(header));
+    for (uint32_t i = 0; i < header.entry_count; i++) {
+        if (entries[i].offset > size || entries[i].size > size - entries[i].offset) {
+            fprintf(stderr, "Asset %.*s lies outside of the pack!\n", ASSET_NAME_SIZE, entries[i].name);
+            return NULL;
+        }
+    }
+
+    asset_pack_t* pack = calloc(1, sizeof(asset_pack_t));
+    pack->data = data;
+    pack->size = size;
+    pack->entries = entries;
+    pack->entry_count = header.entry_count;
+    return pack;
+}
+
+asset_pack_t* asset_pack_open(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return NULL;
+    }
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Failed to read file: %s\n", filename);
+        return NULL;
+    }
+    asset_pack_t* pack = asset_pack_create(mapping, (size_t)st.st_size);
+    if (pack == NULL) {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+    pack->mapping = mapping;
+    return pack;
+}
+
+void asset_pack_destroy(asset_pack_t* pack)
+{
+    if (pack == NULL)
+        return;
+    if (pack->mapping != NULL) {
+        munmap(pack->mapping, pack->size);
+    }
+    free(pack);
+}
+
+int asset_find(const asset_pack_t* pack, const char* name, const void** data, size_t* size)
+{
+    if (pack == NULL || strlen(name) >= ASSET_NAME_SIZE)
+        return FALSE;
+    uint32_t low = 0;
+    uint32_t high = pack->entry_count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        int order = strncmp(name, pack->entries[middle].name, ASSET_NAME_SIZE);
+        if (order == 0) {
+            *data = pack->data + pack->entries[middle].offset;
+            *size = (size_t)pack->entries[middle].size;
+            return TRUE;
+        }
+        if (order < 0) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return FALSE;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_ASSET_H
+#define BRICKS_ASSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Asset packs: every file from Resources/ in one blob. A fixed header is followed by the index,
+// sorted by name, and the file contents, each starting at a multiple of ASSET_PACK_ALIGNMENT.
+#define ASSET_PACK_MAGIC "BRKA"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 16
+#define ASSET_NAME_SIZE 48
+
+typedef struct asset_pack_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t entry_count;
+    uint32_t reserved;
+} asset_pack_header_t;
+
+typedef struct asset_pack_entry {
+    char name[ASSET_NAME_SIZE]; // zero padded
+    uint64_t offset;
+    uint64_t size;
+} asset_pack_entry_t;
+
+typedef struct asset_pack {
+    const unsigned char *data;
+    size_t size;
+    const asset_pack_entry_t *entries;
+    uint32_t entry_count;
+    void *mapping; // set for packs mapped from a file
+} asset_pack_t;
+
+// The pack the build links into the game, generated by bricks_assetpack.
+extern const unsigned char asset_embedded_pack[];
+extern const size_t asset_embedded_pack_size;
+
+// Uses the pack in place, the data has to outlive it.
+asset_pack_t *asset_pack_create(const void *data, size_t size);
+asset_pack_t *asset_pack_open(const char *filename);
+void asset_pack_destroy(asset_pack_t *pack);
+
+// Looks an asset up by its file name in Resources/ and returns FALSE when the pack doesn't have it.
+int asset_find(const asset_pack_t *pack, const char *name, const void **data, size_t *size);
+
+#endif //BRICKS_ASSET_H
@@ -0,0 +1,177 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "asset.h"
+#include "types.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct asset_file {
+    const char *path;
+    const char *name;
+    unsigned char *data;
+    size_t size;
+} asset_file_t;
+
+static int read_asset(asset_file_t* file);
+static int compare_assets(const void* a, const void* b);
+static int write_c_source(const char* filename, const unsigned char* pack, size_t size);
+
+// Packs files into one asset pack, stored under their names without the directory. The pack can be
+// written as is, to be mapped at runtime, and as a C source that links it into a binary.
+int main(int argc, char** argv)
+{
+    const char* pack_filename = NULL;
+    const char* source_filename = NULL;
+    int first_file = 1;
+    for (; first_file < argc; first_file++) {
+        if (strcmp(argv[first_file], "--pack") == 0 && first_file + 1 < argc) {
+            pack_filename = argv[++first_file];
+        } else if (strcmp(argv[first_file], "--c-source") == 0 && first_file + 1 < argc) {
+            source_filename = argv[++first_file];
+        } else {
+            break;
+        }
+    }
+    if (pack_filename == NULL && source_filename == NULL) {
+        fprintf(stderr, "usage: %s [--pack <assets.pak>] [--c-source <assets.c>] <file>...\n", argv[0]);
+        return -1;
+    }
+
+    int count = argc - first_file;
+    asset_file_t* files = calloc(count > 0 ? count : 1, sizeof(asset_file_t));
+    for (int i = 0; i < count; i++) {
+        files[i].path = argv[first_file + i];
+        const char* slash = strrchr(files[i].path, '/');
+        files[i].name = slash != NULL ? slash + 1 : files[i].path;
+        if (strlen(files[i].name) >= ASSET_NAME_SIZE) {
+            fprintf(stderr, "%s: the name is too long for an asset\n", files[i].path);
+            return -1;
+        }
+        if (!read_asset(&files[i])) {
+            return -1;
+        }
+    }
+    // the lookup is a binary search over the index
+    qsort(files, count, sizeof(asset_file_t), compare_assets);
+    for (int i = 1; i < count; i++) {
+        if (strcmp(files[i - 1].name, files[i].name) == 0) {
+            fprintf(stderr, "%s: more than one asset is called %s\n", files[i].path, files[i].name);
+            return -1;
+        }
+    }
+
+    size_t offset = sizeof(asset_pack_header_t) + sizeof(asset_pack_entry_t) * count;
+    asset_pack_entry_t* entries = calloc(count > 0 ? count : 1, sizeof(asset_pack_entry_t));
+    for (int i = 0; i < count; i++) {
+        offset = (offset + ASSET_PACK_ALIGNMENT - 1) / ASSET_PACK_ALIGNMENT * ASSET_PACK_ALIGNMENT;
+        strncpy(entries[i].name, files[i].name, ASSET_NAME_SIZE);
+        entries[i].offset = offset;
+        entries[i].size = files[i].size;
+        offset += files[i].size;
+    }
+    size_t size = offset;
+    unsigned char* pack = calloc(size, 1);
+    asset_pack_header_t header = { .version = ASSET_PACK_VERSION, .header_size = sizeof(header), .entry_count = (uint32_t)count };
+    memcpy(header.magic, ASSET_PACK_MAGIC, 4);
+    memcpy(pack, &header, sizeof(header));
+    memcpy(pack + sizeof(header), entries, sizeof(asset_pack_entry_t) * count);
+    for (int i = 0; i < count; i++) {
+        memcpy(pack + entries[i].offset, files[i].data, files[i].size);
+        free(files[i].data);
+    }
+
+    int written = TRUE;
+    if (pack_filename != NULL) {
+        FILE* file = fopen(pack_filename, "wb");
+        if (file == NULL) {
+            fprintf(stderr, "Failed to open file: %s\n", pack_filename);
+            written = FALSE;
+        } else if ((fwrite(pack, size, 1, file) != 1) | (fclose(file) != 0)) {
+            fprintf(stderr, "Failed to write file: %s\n", pack_filename);
+            written = FALSE;
+        }
+    }
+    if (source_filename != NULL && !write_c_source(source_filename, pack, size)) {
+        written = FALSE;
+    }
+    free(pack);
+    free(entries);
+    free(files);
+    return written ? 0 : -1;
+}
+
+static int read_asset(asset_file_t* file)
+{
+    FILE* f = fopen(file->path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", file->path);
+        return FALSE;
+    }
+    size_t capacity = 1 << 16;
+    file->data = malloc(capacity);
+    file->size = 0;
+    size_t count;
+    while ((count = fread(file->data + file->size, 1, capacity - file->size, f)) > 0) {
+        file->size += count;
+        if (file->size == capacity) {
+            capacity *= 2;
+            file->data = realloc(file->data, capacity);
+        }
+    }
+    int failed = ferror(f);
+    fclose(f);
+    if (failed) {
+        fprintf(stderr, "Failed to read file: %s\n", file->path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int compare_assets(const void* a, const void* b)
+{
+    return strcmp(((const asset_file_t*)a)->name, ((const asset_file_t*)b)->name);
+}
+
+static int write_c_source(const char* filename, const unsigned char* pack, size_t size)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return FALSE;
+    }
+    fprintf(file, "// Generated by bricks_assetpack, do not edit.\n#include \"asset.h\"\n\n");
+    fprintf(file, "const size_t asset_embedded_pack_size = %zu;\n", size);
+    fprintf(file, "__attribute__((aligned(%d))) const unsigned char asset_embedded_pack[] = {", ASSET_PACK_ALIGNMENT);
+    for (size_t i = 0; i < size; i++) {
+        fprintf(file, i % 24 == 0 ? "\n    %u," : "%u,", pack[i]);
+    }
+    fprintf(file, "\n};\n");
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Failed to write file: %s\n", filename);
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -24,43 +24,267 @@
 #include "ball.h"
 #include <malloc.h>
 #include <stddef.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BALL_HAVE_AVX2
+#endif
 
-ball_t* ball_create(int x, int y, int width, int height, int window_width, int window_height, color_t color)
+// the walls and the paddle as seen by the top-left corner of a ball
+typedef struct ball_bounds {
+    float min_y, max_x;
+    float paddle_min_x, paddle_max_x;
+    float paddle_min_y, paddle_max_y;
+} ball_bounds_t;
+
+static int ball_integrate_scalar(ball_set_t* balls, const ball_bounds_t* bounds, int begin, int end);
+#if defined(__SSE2__)
+static int ball_integrate_sse2(ball_set_t* balls, const ball_bounds_t* bounds, int begin, int end);
+#endif
+#if defined(BALL_HAVE_AVX2)
+static int ball_integrate_avx2(ball_set_t* balls, const ball_bounds_t* bounds, int begin, int end);
+#endif
+
+ball_set_t* ball_set_create(int capacity, int width, int height, int window_width, int window_height, color_t color)
 {
-    ball_t* ball = malloc(sizeof(ball_t));
-    ball->x = x;
-    ball->y = y;
-    ball->width = width;
-    ball->height = height;
-    ball->window_width = window_width;
-    ball->window_height = window_height;
-    ball->color = color;
-    ball->x_direction = 1;
-    ball->y_direction = -1;
-    return ball;
+    ball_set_t* balls = calloc(1, sizeof(ball_set_t));
+    float** fields[] = { &balls->x, &balls->y, &balls->previous_x, &balls->previous_y, &balls->velocity_x, &balls->velocity_y };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        *fields[i] = malloc(capacity * sizeof(float));
+    }
+    balls->capacity = capacity;
+    balls->width = width;
+    balls->height = height;
+    balls->window_width = window_width;
+    balls->window_height = window_height;
+    balls->color = color;
+    return balls;
 }
 
-void ball_destroy(ball_t* ball)
+void ball_set_destroy(ball_set_t* balls)
 {
-    if (ball == NULL)
+    if (balls == NULL)
         return;
-    free(ball);
+    free(balls->x);
+    free(balls->y);
+    free(balls->previous_x);
+    free(balls->previous_y);
+    free(balls->velocity_x);
+    free(balls->velocity_y);
+    free(balls);
+}
+
+void ball_set_spawn_point(ball_set_t* balls, float x, float y, float velocity_x, float velocity_y)
+{
+    balls->spawn_x = x;
+    balls->spawn_y = y;
+    balls->spawn_velocity_x = velocity_x;
+    balls->spawn_velocity_y = velocity_y;
 }
 
-void ball_move(ball_t* ball, int amount)
+// Returns the index of the new ball, or -1 once the set is full.
+int ball_set_add(ball_set_t* balls, float x, float y, float velocity_x, float velocity_y)
 {
-    if (ball->x <= 0) {
-        ball->x_direction = 1;
+    if (balls->count == balls->capacity)
+        return -1;
+    int i = balls->count++;
+    balls->x[i] = x;
+    balls->y[i] = y;
+    // a new ball is a jump, not a movement to interpolate
+    balls->previous_x[i] = x;
+    balls->previous_y[i] = y;
+    balls->velocity_x[i] = velocity_x;
+    balls->velocity_y[i] = velocity_y;
+    return i;
+}
+
+// Moves the last ball into the hole, so indices past the removed one change.
+void ball_set_remove(ball_set_t* balls, int index)
+{
+    ball_set_swap(balls, index, --balls->count);
+}
+
+void ball_set_swap(ball_set_t* balls, int a, int b)
+{
+    float* fields[] = { balls->x, balls->y, balls->previous_x, balls->previous_y, balls->velocity_x, balls->velocity_y };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        float tmp = fields[i][a];
+        fields[i][a] = fields[i][b];
+        fields[i][b] = tmp;
     }
-    if (ball->x >= ball->window_width) {
-        ball->x_direction = -1;
+}
+
+void ball_set_reset(ball_set_t* balls)
+{
+    balls->count = 0;
+    ball_set_add(balls, balls->spawn_x, balls->top + balls->spawn_y, balls->spawn_velocity_x, balls->spawn_velocity_y);
+}
+
+void ball_set_translate(ball_set_t* balls, float dy)
+{
+    for (int i = 0; i < balls->count; i++) {
+        balls->y[i] += dy;
+        balls->previous_y[i] += dy;
     }
-    if (ball->y <= 0) {
-        ball->y_direction = 1;
+}
+
+void ball_set_save_positions(ball_set_t* balls)
+{
+    memcpy(balls->previous_x, balls->x, balls->count * sizeof(float));
+    memcpy(balls->previous_y, balls->y, balls->count * sizeof(float));
+}
+
+// Moves the balls in [begin, end) by one tick's velocity, reflecting them off the left, right
+// and top walls and bouncing the ones that overlap the paddle while falling. Bricks aren't looked
+// at, that's left to the caller for the balls that are near one.
+void ball_set_integrate(ball_set_t* balls, int begin, int end, float paddle_x, float paddle_y, float paddle_width, float paddle_height)
+{
+    ball_bounds_t bounds = {
+        .min_y = balls->top,
+        .max_x = (float)(balls->window_width - balls->width),
+        .paddle_min_x = paddle_x - balls->width,
+        .paddle_max_x = paddle_x + paddle_width,
+        .paddle_min_y = paddle_y - balls->height,
+        .paddle_max_y = paddle_y + paddle_height,
+    };
+#if defined(BALL_HAVE_AVX2)
+    if (end - begin >= 8 && __builtin_cpu_supports("avx2"))
+        begin = ball_integrate_avx2(balls, &bounds, begin, end);
+#endif
+#if defined(__SSE2__)
+    if (end - begin >= 4)
+        begin = ball_integrate_sse2(balls, &bounds, begin, end);
+#endif
+    ball_integrate_scalar(balls, &bounds, begin, end);
+}
+
+void ball_interpolate(const ball_set_t* balls, int index, double alpha, int* x, int* y)
+{
+    *x = (int)(balls->previous_x[index] + (balls->x[index] - balls->previous_x[index]) * alpha);
+    *y = (int)(balls->previous_y[index] + (balls->y[index] - balls->previous_y[index]) * alpha);
+}
+
+// The kernels below all do the same thing and return the index of the first ball they didn't get
+// to, which the narrower ones pick up.
+static int ball_integrate_scalar(ball_set_t* balls, const ball_bounds_t* bounds, int begin, int end)
+{
+    for (int i = begin; i < end; i++) {
+        float x = balls->x[i] + balls->velocity_x[i];
+        float y = balls->y[i] + balls->velocity_y[i];
+        float velocity_x = balls->velocity_x[i];
+        float velocity_y = balls->velocity_y[i];
+        if (x < 0.0f && velocity_x < 0.0f) {
+            x = -x;
+            velocity_x = -velocity_x;
+        }
+        if (x > bounds->max_x && velocity_x > 0.0f) {
+            x = 2.0f * bounds->max_x - x;
+            velocity_x = -velocity_x;
+        }
+        if (y < bounds->min_y && velocity_y < 0.0f) {
+            y = 2.0f * bounds->min_y - y;
+            velocity_y = -velocity_y;
+        }
+        if (velocity_y > 0.0f && x > bounds->paddle_min_x && x < bounds->paddle_max_x && y > bounds->paddle_min_y && y < bounds->paddle_max_y) {
+            velocity_y = -velocity_y;
+        }
+        balls->x[i] = x;
+        balls->y[i] = y;
+        balls->velocity_x[i] = velocity_x;
+        balls->velocity_y[i] = velocity_y;
+    }
+    return end;
+}
+
+#if defined(__SSE2__)
+static int ball_integrate_sse2(ball_set_t* balls, const ball_bounds_t* bounds, int begin, int end)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 min_y = _mm_set1_ps(bounds->min_y);
+    const __m128 twice_min_y = _mm_set1_ps(2.0f * bounds->min_y);
+    const __m128 max_x = _mm_set1_ps(bounds->max_x);
+    const __m128 twice_max_x = _mm_set1_ps(2.0f * bounds->max_x);
+    const __m128 paddle_min_x = _mm_set1_ps(bounds->paddle_min_x);
+    const __m128 paddle_max_x = _mm_set1_ps(bounds->paddle_max_x);
+    const __m128 paddle_min_y = _mm_set1_ps(bounds->paddle_min_y);
+    const __m128 paddle_max_y = _mm_set1_ps(bounds->paddle_max_y);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 velocity_x = _mm_loadu_ps(balls->velocity_x + i);
+        __m128 velocity_y = _mm_loadu_ps(balls->velocity_y + i);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(balls->x + i), velocity_x);
+        __m128 y = _mm_add_ps(_mm_loadu_ps(balls->y + i), velocity_y);
+
+        // left wall, flipping the sign mirrors the position and the velocity
+        __m128 hit = _mm_and_ps(_mm_cmplt_ps(x, zero), _mm_cmplt_ps(velocity_x, zero));
+        x = _mm_xor_ps(x, _mm_and_ps(hit, sign));
+        velocity_x = _mm_xor_ps(velocity_x, _mm_and_ps(hit, sign));
+        // right wall
+        hit = _mm_and_ps(_mm_cmpgt_ps(x, max_x), _mm_cmpgt_ps(velocity_x, zero));
+        x = _mm_or_ps(_mm_andnot_ps(hit, x), _mm_and_ps(hit, _mm_sub_ps(twice_max_x, x)));
+        velocity_x = _mm_xor_ps(velocity_x, _mm_and_ps(hit, sign));
+        // top wall
+        hit = _mm_and_ps(_mm_cmplt_ps(y, min_y), _mm_cmplt_ps(velocity_y, zero));
+        y = _mm_or_ps(_mm_andnot_ps(hit, y), _mm_and_ps(hit, _mm_sub_ps(twice_min_y, y)));
+        velocity_y = _mm_xor_ps(velocity_y, _mm_and_ps(hit, sign));
+        // paddle
+        hit = _mm_and_ps(_mm_cmpgt_ps(velocity_y, zero),
+            _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(x, paddle_min_x), _mm_cmplt_ps(x, paddle_max_x)),
+                _mm_and_ps(_mm_cmpgt_ps(y, paddle_min_y), _mm_cmplt_ps(y, paddle_max_y))));
+        velocity_y = _mm_xor_ps(velocity_y, _mm_and_ps(hit, sign));
+
+        _mm_storeu_ps(balls->x + i, x);
+        _mm_storeu_ps(balls->y + i, y);
+        _mm_storeu_ps(balls->velocity_x + i, velocity_x);
+        _mm_storeu_ps(balls->velocity_y + i, velocity_y);
     }
-    if (ball->y >= ball->window_height) {
-        ball->y_direction = -1;
+    return i;
+}
+#endif
+
+#if defined(BALL_HAVE_AVX2)
+__attribute__((target("avx2"))) static int ball_integrate_avx2(ball_set_t* balls, const ball_bounds_t* bounds, int begin, int end)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 min_y = _mm256_set1_ps(bounds->min_y);
+    const __m256 twice_min_y = _mm256_set1_ps(2.0f * bounds->min_y);
+    const __m256 max_x = _mm256_set1_ps(bounds->max_x);
+    const __m256 twice_max_x = _mm256_set1_ps(2.0f * bounds->max_x);
+    const __m256 paddle_min_x = _mm256_set1_ps(bounds->paddle_min_x);
+    const __m256 paddle_max_x = _mm256_set1_ps(bounds->paddle_max_x);
+    const __m256 paddle_min_y = _mm256_set1_ps(bounds->paddle_min_y);
+    const __m256 paddle_max_y = _mm256_set1_ps(bounds->paddle_max_y);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 velocity_x = _mm256_loadu_ps(balls->velocity_x + i);
+        __m256 velocity_y = _mm256_loadu_ps(balls->velocity_y + i);
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(balls->x + i), velocity_x);
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(balls->y + i), velocity_y);
+
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_LT_OQ), _mm256_cmp_ps(velocity_x, zero, _CMP_LT_OQ));
+        x = _mm256_xor_ps(x, _mm256_and_ps(hit, sign));
+        velocity_x = _mm256_xor_ps(velocity_x, _mm256_and_ps(hit, sign));
+        hit = _mm256_and_ps(_mm256_cmp_ps(x, max_x, _CMP_GT_OQ), _mm256_cmp_ps(velocity_x, zero, _CMP_GT_OQ));
+        x = _mm256_blendv_ps(x, _mm256_sub_ps(twice_max_x, x), hit);
+        velocity_x = _mm256_xor_ps(velocity_x, _mm256_and_ps(hit, sign));
+        hit = _mm256_and_ps(_mm256_cmp_ps(y, min_y, _CMP_LT_OQ), _mm256_cmp_ps(velocity_y, zero, _CMP_LT_OQ));
+        y = _mm256_blendv_ps(y, _mm256_sub_ps(twice_min_y, y), hit);
+        velocity_y = _mm256_xor_ps(velocity_y, _mm256_and_ps(hit, sign));
+        hit = _mm256_and_ps(_mm256_cmp_ps(velocity_y, zero, _CMP_GT_OQ),
+            _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(x, paddle_min_x, _CMP_GT_OQ), _mm256_cmp_ps(x, paddle_max_x, _CMP_LT_OQ)),
+                _mm256_and_ps(_mm256_cmp_ps(y, paddle_min_y, _CMP_GT_OQ), _mm256_cmp_ps(y, paddle_max_y, _CMP_LT_OQ))));
+        velocity_y = _mm256_xor_ps(velocity_y, _mm256_and_ps(hit, sign));
+
+        _mm256_storeu_ps(balls->x + i, x);
+        _mm256_storeu_ps(balls->y + i, y);
+        _mm256_storeu_ps(balls->velocity_x + i, velocity_x);
+        _mm256_storeu_ps(balls->velocity_y + i, velocity_y);
     }
-    ball->x += amount * ball->x_direction;
-    ball->y += amount * ball->y_direction;
+    return i;
 }
+#endif
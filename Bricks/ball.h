@@ -26,16 +26,35 @@
 
 #include "types.h"
 
-typedef struct ball {
-    int x, y;
+// All balls in play, stored as one array per field so the update can run over several balls at
+// once. Every ball shares the same size and color.
+typedef struct ball_set {
+    float *x, *y;
+    float *previous_x, *previous_y; // positions at the start of the current tick
+    float *velocity_x, *velocity_y; // pixels per tick
+    int count, capacity;
     int width, height;
+    float spawn_x, spawn_y;
+    float spawn_velocity_x, spawn_velocity_y;
     color_t color;
     int window_height, window_width;
-    int x_direction, y_direction;
-} ball_t;
+    float top; // y of the playfield's top edge, which moves in scrolling levels
+} ball_set_t;
 
-ball_t *ball_create(int x, int y, int width, int height, int window_width, int window_height, color_t color);
-void ball_move(ball_t *ball, int amount);
-void ball_destroy(ball_t *ball);
+ball_set_t *ball_set_create(int capacity, int width, int height, int window_width, int window_height, color_t color);
+void ball_set_destroy(ball_set_t *balls);
+
+void ball_set_spawn_point(ball_set_t *balls, float x, float y, float velocity_x, float velocity_y);
+int ball_set_add(ball_set_t *balls, float x, float y, float velocity_x, float velocity_y);
+void ball_set_remove(ball_set_t *balls, int index);
+void ball_set_swap(ball_set_t *balls, int a, int b);
+// Starts over with a single ball at the spawn point, which is relative to the top edge.
+void ball_set_reset(ball_set_t *balls);
+// Moves every ball, along with the position it had at the start of the tick.
+void ball_set_translate(ball_set_t *balls, float dy);
+
+void ball_set_save_positions(ball_set_t *balls);
+void ball_set_integrate(ball_set_t *balls, int begin, int end, float paddle_x, float paddle_y, float paddle_width, float paddle_height);
+void ball_interpolate(const ball_set_t *balls, int index, double alpha, int *x, int *y);
 
 #endif //BRICKS_BALL_H
@@ -0,0 +1,214 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "bot.h"
+#include "clock.h"
+#include "game.h"
+#include "level.h"
+#include "pool.h"
+#include "types.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_GAMES 1000
+#define DEFAULT_SEED 1
+// ten minutes of play at 60 ticks per second
+#define DEFAULT_MAX_TICKS (60 * 60 * 10)
+#define DEFAULT_BALL_COUNT 1
+
+typedef struct batch_result {
+    int cleared;
+    long ticks;
+    int lives_lost;
+    int bricks_left;
+} batch_result_t;
+
+typedef struct batch {
+    level_t** levels;
+    const char** level_names;
+    int level_count;
+    int games;
+    unsigned seed;
+    long max_ticks;
+    int ball_count;
+    batch_result_t* results; // games results per level, level after level
+} batch_t;
+
+static void batch_play(void* context, int job, int worker);
+static void batch_report(const batch_t* batch, int level);
+static int parse_long(const char* text, long max, long* value);
+static int compare_doubles(const void* a, const void* b);
+static double percentile(const double* sorted, int count, double q);
+
+int main(int argc, char** argv)
+{
+    batch_t batch = {
+        .games = DEFAULT_GAMES,
+        .seed = DEFAULT_SEED,
+        .max_ticks = DEFAULT_MAX_TICKS,
+        .ball_count = DEFAULT_BALL_COUNT,
+    };
+    int worker_count = pool_default_workers();
+    batch.levels = malloc(argc * sizeof(level_t*));
+    batch.level_names = malloc(argc * sizeof(const char*));
+    int valid = TRUE;
+    for (int i = 1; i < argc && valid; i++) {
+        long value = 0;
+        if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            valid = parse_long(argv[++i], INT_MAX, &value);
+            batch.games = (int)value;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            valid = parse_long(argv[++i], INT_MAX, &value);
+            worker_count = (int)value;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            valid = parse_long(argv[++i], UINT_MAX, &value);
+            batch.seed = (unsigned)value;
+        } else if (strcmp(argv[i], "--max-ticks") == 0 && i + 1 < argc) {
+            valid = parse_long(argv[++i], LONG_MAX, &batch.max_ticks);
+        } else if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc) {
+            valid = parse_long(argv[++i], INT_MAX, &value);
+            batch.ball_count = (int)value;
+        } else if (argv[i][0] == '-') {
+            valid = FALSE;
+        } else {
+            batch.level_names[batch.level_count++] = argv[i];
+        }
+    }
+    // every game gets a job index and a result slot
+    if (!valid || batch.level_count == 0 || batch.games <= 0 || worker_count <= 0 || batch.max_ticks <= 0 || batch.ball_count <= 0
+        || (long long)batch.level_count * batch.games > INT_MAX) {
+        fprintf(stderr, "usage: %s [--games N] [--threads N] [--seed N] [--max-ticks N] [--balls N] <level>...\n", argv[0]);
+        return -1;
+    }
+    for (int l = 0; l < batch.level_count; l++) {
+        batch.levels[l] = level_create(batch.level_names[l]);
+        if (batch.levels[l] == NULL)
+            return -1;
+    }
+
+    int job_count = batch.level_count * batch.games;
+    batch.results = calloc(job_count, sizeof(batch_result_t));
+    double start = clock_seconds();
+    pool_run(worker_count, job_count, batch_play, &batch);
+    double seconds = clock_seconds() - start;
+
+    long ticks = 0;
+    for (int i = 0; i < job_count; i++) {
+        ticks += batch.results[i].ticks;
+    }
+    for (int l = 0; l < batch.level_count; l++) {
+        batch_report(&batch, l);
+        level_destroy(batch.levels[l]);
+    }
+    fprintf(stderr, "%d games on %d threads in %.2f s (%.0f games/s, %.0f ticks/s)\n",
+        job_count, worker_count, seconds, job_count / seconds, ticks / seconds);
+    free(batch.results);
+    free(batch.levels);
+    free(batch.level_names);
+    return 0;
+}
+
+// Plays one game to the end. Game n of every level uses the same seed, so levels are compared
+// on the same bot behaviour.
+static void batch_play(void* context, int job, int worker)
+{
+    (void)worker;
+    batch_t* batch = context;
+    game_t* game = game_create(level_copy(batch->levels[job / batch->games]), batch->ball_count);
+    bot_t bot;
+    bot_init(&bot, batch->seed + job % batch->games);
+    while (game->tick < batch->max_ticks && !game_lost(game) && !game_cleared(game)) {
+        bot_play(&bot, game);
+        game_tick(game, game->tick);
+    }
+    batch_result_t* result = &batch->results[job];
+    result->cleared = game_cleared(game);
+    result->ticks = game->tick;
+    result->lives_lost = GAME_LIFE_COUNT - game->life_count;
+    result->bricks_left = game->level->brick_count;
+    game_destroy(game);
+}
+
+// Prints one JSON object per level. Clear times only count the games that cleared the level.
+static void batch_report(const batch_t* batch, int level)
+{
+    const batch_result_t* results = batch->results + level * batch->games;
+    double* clear_ticks = malloc(batch->games * sizeof(double));
+    double* bricks_left = malloc(batch->games * sizeof(double));
+    int cleared = 0;
+    double lives_lost = 0;
+    double bricks_total = 0;
+    for (int i = 0; i < batch->games; i++) {
+        if (results[i].cleared)
+            clear_ticks[cleared++] = results[i].ticks;
+        bricks_left[i] = results[i].bricks_left;
+        lives_lost += results[i].lives_lost;
+        bricks_total += results[i].bricks_left;
+    }
+    qsort(clear_ticks, cleared, sizeof(double), compare_doubles);
+    qsort(bricks_left, batch->games, sizeof(double), compare_doubles);
+
+    printf("{\"level\":\"%s\",\"games\":%d,\"cleared\":%d,\"clear_rate\":%.3f,", batch->level_names[level], batch->games,
+        cleared, (double)cleared / batch->games);
+    if (cleared > 0) {
+        double total = 0;
+        for (int i = 0; i < cleared; i++) {
+            total += clear_ticks[i];
+        }
+        printf("\"clear_ticks_mean\":%.1f,\"clear_ticks_p50\":%.0f,\"clear_ticks_p90\":%.0f,", total / cleared,
+            percentile(clear_ticks, cleared, 0.5), percentile(clear_ticks, cleared, 0.9));
+    } else {
+        printf("\"clear_ticks_mean\":null,\"clear_ticks_p50\":null,\"clear_ticks_p90\":null,");
+    }
+    printf("\"lives_lost_mean\":%.2f,\"bricks_left_mean\":%.1f,\"bricks_left_p50\":%.0f}\n", lives_lost / batch->games,
+        bricks_total / batch->games, percentile(bricks_left, batch->games, 0.5));
+    free(clear_ticks);
+    free(bricks_left);
+}
+
+// A whole decimal number in [0, max], nothing else.
+static int parse_long(const char* text, long max, long* value)
+{
+    char* end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || parsed < 0 || parsed > max)
+        return FALSE;
+    *value = parsed;
+    return TRUE;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static double percentile(const double* sorted, int count, double q)
+{
+    return sorted[(int)((count - 1) * q + 0.5)];
+}
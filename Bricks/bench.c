@@ -0,0 +1,679 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "alloc_stats.h"
+#include "ball.h"
+#include "brick_layer.h"
+#include "clock.h"
+#include "framebuffer.h"
+#include "game.h"
+#include "level.h"
+#include "paddle.h"
+#include "particle.h"
+#include "renderer.h"
+#include "sim.h"
+#include "snapshot.h"
+#include "sprite.h"
+#include "startup.h"
+#include "types.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every result is printed as one JSON object per line, so runs of different commits can be diffed.
+
+#define BENCH_WINDOW_WIDTH 800
+#define BENCH_WINDOW_HEIGHT 600
+#define BENCH_BRICK_WIDTH 40
+#define BENCH_BRICK_HEIGHT 10
+// bricks in the collision levels must survive the whole run, or later samples measure an emptier level
+#define BENCH_UNBREAKABLE 1000000000
+
+typedef struct bench_options {
+    const char* filter;
+    int quick;
+} bench_options_t;
+
+typedef struct bench_samples {
+    double* ns;
+    int count;
+    alloc_stats_t start;
+    alloc_stats_t allocated;
+} bench_samples_t;
+
+static int bench_enabled(const bench_options_t* options, const char* name);
+static void bench_samples_init(bench_samples_t* samples, int count);
+static void bench_begin_sample(bench_samples_t* samples, double* start);
+static void bench_end_sample(bench_samples_t* samples, double start, int ops);
+static void bench_report(const char* name, const char* variant, bench_samples_t* samples, int ops_per_sample);
+static int write_level_csv(const char* filename, int rows, int columns, int x_step, int y_step, int life_count);
+
+static void bench_level_create(const bench_options_t* options);
+static void bench_collide_with_bricks(const bench_options_t* options);
+static void bench_move_balls(const bench_options_t* options);
+static void bench_draw(const bench_options_t* options);
+static void bench_startup(const bench_options_t* options);
+static void bench_snapshot(const bench_options_t* options);
+static void bench_particles(const bench_options_t* options);
+static void bench_fill(const bench_options_t* options);
+static void bench_first_frame(renderer_t* ren, const level_t* level);
+
+int main(int argc, char** argv)
+{
+    bench_options_t options = { .filter = NULL, .quick = FALSE };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            options.quick = TRUE;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--filter <benchmark>]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (!alloc_stats_enabled()) {
+        fprintf(stderr, "Allocation counting is not available in this build, allocs_per_op is reported as null.\n");
+    }
+
+    if (bench_enabled(&options, "level_create"))
+        bench_level_create(&options);
+    if (bench_enabled(&options, "collide_with_bricks"))
+        bench_collide_with_bricks(&options);
+    if (bench_enabled(&options, "move_balls"))
+        bench_move_balls(&options);
+    if (bench_enabled(&options, "draw"))
+        bench_draw(&options);
+    if (bench_enabled(&options, "startup"))
+        bench_startup(&options);
+    if (bench_enabled(&options, "snapshot"))
+        bench_snapshot(&options);
+    if (bench_enabled(&options, "particles"))
+        bench_particles(&options);
+    if (bench_enabled(&options, "fill"))
+        bench_fill(&options);
+    return 0;
+}
+
+static void bench_level_create(const bench_options_t* options)
+{
+    const int rows[] = { 1000, 10000, 100000, 1000000 };
+    const char* tmp_dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    for (size_t r = 0; r < sizeof(rows) / sizeof(rows[0]); r++) {
+        if (options->quick && rows[r] > 100000)
+            break;
+        char filename[512];
+        snprintf(filename, sizeof(filename), "%s/bricks_bench_%d.csv", tmp_dir, rows[r]);
+        if (!write_level_csv(filename, rows[r], 100, 50, 20, 2))
+            continue;
+
+        int sample_count = 2000000 / rows[r];
+        if (sample_count < 5)
+            sample_count = 5;
+        if (sample_count > 200)
+            sample_count = 200;
+        bench_samples_t samples;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            level_t* level = level_create(filename);
+            bench_end_sample(&samples, start, 1);
+            level_destroy(level);
+        }
+        char variant[32];
+        snprintf(variant, sizeof(variant), "rows_%d", rows[r]);
+        bench_report("level_create", variant, &samples, 1);
+
+        // the same level compiled to the binary format
+        char compiled_filename[512];
+        snprintf(compiled_filename, sizeof(compiled_filename), "%s/bricks_bench_%d.brl", tmp_dir, rows[r]);
+        level_t* level = level_create(filename);
+        int compiled = level != NULL && level_write_binary(level, compiled_filename);
+        level_destroy(level);
+        remove(filename);
+        if (!compiled)
+            continue;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            level = level_create(compiled_filename);
+            bench_end_sample(&samples, start, 1);
+            level_destroy(level);
+        }
+        snprintf(variant, sizeof(variant), "binary_rows_%d", rows[r]);
+        bench_report("level_create", variant, &samples, 1);
+        remove(compiled_filename);
+    }
+}
+
+static void bench_collide_with_bricks(const bench_options_t* options)
+{
+    typedef struct collision_case {
+        const char* variant;
+        int rows, columns;
+        int x_step, y_step;
+        int speed;
+    } collision_case_t;
+    // dense levels pack bricks edge to edge, sparse ones leave most of the field empty.
+    // fast balls move several brick heights per tick
+    const collision_case_t cases[] = {
+        { "dense_1k", 50, 20, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, 5 },
+        { "dense_10k", 100, 100, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, 5 },
+        { "dense_100k", 250, 400, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, 5 },
+        { "sparse_1k", 50, 20, 200, 200, 5 },
+        { "sparse_10k", 100, 100, 200, 200, 5 },
+        { "sparse_100k", 250, 400, 200, 200, 5 },
+        { "dense_10k_fast", 100, 100, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, 60 },
+        { "sparse_10k_fast", 100, 100, 200, 200, 60 },
+    };
+    const int ops_per_sample = 100;
+    const int sample_count = options->quick ? 200 : 2000;
+    const char* tmp_dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const collision_case_t* cc = &cases[c];
+        char filename[512];
+        snprintf(filename, sizeof(filename), "%s/bricks_bench_%s.csv", tmp_dir, cc->variant);
+        if (!write_level_csv(filename, cc->rows * cc->columns, cc->columns, cc->x_step, cc->y_step, BENCH_UNBREAKABLE))
+            continue;
+        level_t* level = level_create(filename);
+        remove(filename);
+        if (level == NULL)
+            continue;
+
+        int field_width = cc->columns * cc->x_step;
+        int field_height = cc->rows * cc->y_step;
+        // the ball starts below the bricks, bounces around under them and respawns once it's lost
+        ball_set_t* balls = ball_set_create(1, 10, 10, field_width, field_height + 200, COLOR_WHITE);
+        ball_set_spawn_point(balls, field_width / 2, field_height + 100, cc->speed, -cc->speed);
+        ball_set_reset(balls);
+        bench_samples_t samples;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            for (int op = 0; op < ops_per_sample; op++) {
+                sim_move_balls(level, balls, NULL);
+                sim_check_loose_life(balls);
+            }
+            bench_end_sample(&samples, start, ops_per_sample);
+        }
+        bench_report("collide_with_bricks", cc->variant, &samples, ops_per_sample);
+        ball_set_destroy(balls);
+        level_destroy(level);
+    }
+}
+
+// One op is one ball moving through one tick, so ops_per_ms is the ball throughput.
+static void bench_move_balls(const bench_options_t* options)
+{
+    const int ball_counts[] = { 100, 1000, 10000 };
+    const int sample_count = options->quick ? 100 : 1000;
+    // a full screen of bricks that never break, so the field looks the same for every sample
+    char filename[512];
+    const char* tmp_dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    snprintf(filename, sizeof(filename), "%s/bricks_bench_balls.csv", tmp_dir);
+    if (!write_level_csv(filename, 400, 20, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, BENCH_UNBREAKABLE))
+        return;
+    level_t* level = level_create(filename);
+    remove(filename);
+    if (level == NULL)
+        return;
+    paddle_t* paddle = paddle_create(BENCH_WINDOW_WIDTH / 2 - 50, BENCH_WINDOW_HEIGHT - 30, 100, 20, BENCH_WINDOW_WIDTH, COLOR_WHITE);
+    for (size_t c = 0; c < sizeof(ball_counts) / sizeof(ball_counts[0]); c++) {
+        int count = ball_counts[c];
+        ball_set_t* balls = ball_set_create(count, 10, 10, BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, COLOR_WHITE);
+        bench_samples_t samples;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            // serve lost balls again so every sample moves the same number of them
+            for (int b = balls->count; b < count; b++) {
+                float angle = 0.5f + 2.0f * b / count;
+                ball_set_add(balls, BENCH_WINDOW_WIDTH / 2, BENCH_WINDOW_HEIGHT / 2, 7.0f * cosf(angle), -7.0f * sinf(angle));
+            }
+            double start;
+            bench_begin_sample(&samples, &start);
+            sim_tick(level, balls, paddle);
+            bench_end_sample(&samples, start, count);
+        }
+        char variant[32];
+        snprintf(variant, sizeof(variant), "balls_%d", count);
+        bench_report("move_balls", variant, &samples, count);
+        ball_set_destroy(balls);
+    }
+    paddle_destroy(paddle);
+    level_destroy(level);
+}
+
+static void bench_draw(const bench_options_t* options)
+{
+    // the dummy video driver and the software renderer let this run on machines without a GPU
+    setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    renderer_t* ren = renderer_create("bricks_bench", BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT);
+    if (ren == NULL) {
+        fprintf(stderr, "Skipping draw benchmarks, no renderer available!\n");
+        return;
+    }
+
+    level_t* levels[2];
+    const char* variants[2] = { "random", "dense_1200" };
+    levels[0] = level_create_random_level(BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT);
+    char filename[512];
+    const char* tmp_dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    snprintf(filename, sizeof(filename), "%s/bricks_bench_draw.csv", tmp_dir);
+    levels[1] = write_level_csv(filename, 1200, 20, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, 2) ? level_create(filename) : NULL;
+    remove(filename);
+    sprite_atlas_t* atlas = sprite_atlas_create(ren, NULL);
+    if (atlas == NULL) {
+        fprintf(stderr, "Skipping sprite draw benchmarks, no atlas available!\n");
+    }
+
+    const int sample_count = options->quick ? 50 : 500;
+    for (int l = 0; l < 2; l++) {
+        level_t* level = levels[l];
+        if (level == NULL)
+            continue;
+
+        bench_samples_t samples;
+        char variant[64];
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            renderer_clear(ren, COLOR_BLACK);
+            for (int b = 0; b < level->brick_count; b++) {
+                renderer_draw_rect(ren, level->x[b], level->y[b], level->width[b], level->height[b], level_brick_color(level, b));
+            }
+            renderer_present(ren);
+            bench_end_sample(&samples, start, 1);
+        }
+        snprintf(variant, sizeof(variant), "immediate_%s", variants[l]);
+        bench_report("draw", variant, &samples, 1);
+
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            renderer_clear(ren, COLOR_BLACK);
+            renderer_begin_rects(ren);
+            for (int b = 0; b < level->brick_count; b++) {
+                renderer_push_rect(ren, level->x[b], level->y[b], level->width[b], level->height[b], level_brick_color(level, b));
+            }
+            renderer_flush_rects(ren);
+            renderer_present(ren);
+            bench_end_sample(&samples, start, 1);
+        }
+        snprintf(variant, sizeof(variant), "batched_%s", variants[l]);
+        bench_report("draw", variant, &samples, 1);
+
+        // weakens one brick per frame, so most frames patch a single dirty rect
+        brick_layer_t* layer = brick_layer_create(ren, BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT);
+        if (layer != NULL) {
+            brick_layer_update(layer, ren, level);
+            bench_samples_init(&samples, sample_count);
+            for (int i = 0; i < sample_count; i++) {
+                double start;
+                bench_begin_sample(&samples, &start);
+                level_hit_brick(level, i % level->brick_count);
+                brick_layer_draw(layer, ren, level);
+                renderer_present(ren);
+                bench_end_sample(&samples, start, 1);
+            }
+            snprintf(variant, sizeof(variant), "layer_%s", variants[l]);
+            bench_report("draw", variant, &samples, 1);
+            brick_layer_destroy(layer);
+        }
+
+        // the same, with the field in one geometry call where a hit rewrites a single quad
+        sprite_field_t* field = atlas != NULL ? sprite_field_create() : NULL;
+        if (field != NULL) {
+            sprite_field_update(field, atlas, level);
+            bench_samples_init(&samples, sample_count);
+            for (int i = 0; i < sample_count; i++) {
+                double start;
+                bench_begin_sample(&samples, &start);
+                level_hit_brick(level, i % level->brick_count);
+                renderer_clear(ren, COLOR_BLACK);
+                sprite_field_draw(field, atlas, ren, level);
+                renderer_present(ren);
+                bench_end_sample(&samples, start, 1);
+            }
+            snprintf(variant, sizeof(variant), "sprites_%s", variants[l]);
+            bench_report("draw", variant, &samples, 1);
+            sprite_field_destroy(field);
+        }
+        level_destroy(level);
+    }
+    sprite_atlas_destroy(atlas);
+    renderer_destroy(ren);
+}
+
+// Time to the first presented frame, loading everything in sequence or with the level and the font on a worker.
+static void bench_startup(const bench_options_t* options)
+{
+    setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    char filename[512];
+    const char* tmp_dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    snprintf(filename, sizeof(filename), "%s/bricks_bench_startup.csv", tmp_dir);
+    if (!write_level_csv(filename, 1200, 20, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, 2))
+        return;
+
+    const int sample_count = options->quick ? 5 : 20;
+    bench_samples_t samples;
+    bench_samples_init(&samples, sample_count);
+    for (int i = 0; i < sample_count; i++) {
+        double start;
+        bench_begin_sample(&samples, &start);
+        level_t* level = level_create(filename);
+        renderer_t* ren = renderer_create("bricks_bench", BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT);
+        if (ren == NULL || level == NULL) {
+            fprintf(stderr, "Skipping startup benchmarks, no renderer available!\n");
+            level_destroy(level);
+            free(samples.ns);
+            remove(filename);
+            return;
+        }
+        bench_first_frame(ren, level);
+        bench_end_sample(&samples, start, 1);
+        renderer_destroy(ren);
+        level_destroy(level);
+    }
+    bench_report("startup", "sequential", &samples, 1);
+
+    bench_samples_init(&samples, sample_count);
+    for (int i = 0; i < sample_count; i++) {
+        double start;
+        bench_begin_sample(&samples, &start);
+        startup_t startup;
+        startup_begin(&startup, NULL, filename, BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, TRUE, FALSE);
+        renderer_t* ren = renderer_create_window("bricks_bench", BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT);
+        startup_finish(&startup);
+        renderer_set_font(ren, startup.font);
+        bench_first_frame(ren, startup.level);
+        bench_end_sample(&samples, start, 1);
+        renderer_destroy(ren);
+        level_destroy(startup.level);
+    }
+    bench_report("startup", "pipelined", &samples, 1);
+    remove(filename);
+}
+
+// Captures a game with a few balls tick by tick, then steps it back through the ring. The size
+// of a full snapshot and the average delta per tick are reported along with the times.
+static void bench_snapshot(const bench_options_t* options)
+{
+    const int brick_counts[] = { 1000, 10000, 100000 };
+    const int sample_count = options->quick ? 200 : 1000;
+    const char* tmp_dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+    for (size_t c = 0; c < sizeof(brick_counts) / sizeof(brick_counts[0]); c++) {
+        int count = brick_counts[c];
+        char filename[512];
+        snprintf(filename, sizeof(filename), "%s/bricks_bench_snapshot.csv", tmp_dir);
+        if (!write_level_csv(filename, count, 20, BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT, 2))
+            return;
+        level_t* level = level_create(filename);
+        remove(filename);
+        if (level == NULL)
+            return;
+        game_t* game = game_create(level, 8);
+        snapshot_ring_t* ring = snapshot_ring_create(game, sample_count);
+
+        bench_samples_t samples;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            game_step(game, 0);
+            if (game_lost(game)) {
+                game->life_count = GAME_LIFE_COUNT;
+            }
+            double start;
+            bench_begin_sample(&samples, &start);
+            snapshot_ring_capture(ring, game);
+            bench_end_sample(&samples, start, 1);
+        }
+        char variant[32];
+        snprintf(variant, sizeof(variant), "capture_%dk", count / 1000);
+        bench_report("snapshot", variant, &samples, 1);
+        printf("{\"bench\":\"snapshot\",\"variant\":\"size_%dk\",\"snapshot_bytes\":%zu,\"delta_bytes_per_tick\":%.1f}\n",
+            count / 1000, snapshot_ring_snapshot_size(ring), (double)ring->stats.delta_bytes / ring->stats.captures);
+
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            snapshot_ring_rewind(ring, game);
+            bench_end_sample(&samples, start, 1);
+        }
+        snprintf(variant, sizeof(variant), "rewind_%dk", count / 1000);
+        bench_report("snapshot", variant, &samples, 1);
+
+        snapshot_ring_save(ring);
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            snapshot_ring_load(ring, game);
+            bench_end_sample(&samples, start, 1);
+        }
+        snprintf(variant, sizeof(variant), "load_%dk", count / 1000);
+        bench_report("snapshot", variant, &samples, 1);
+        snapshot_ring_destroy(ring);
+        game_destroy(game);
+    }
+}
+
+// A pool kept at the given number of particles, moved a tick and then drawn in one geometry call.
+static void bench_particles(const bench_options_t* options)
+{
+    const int particle_counts[] = { 10000, 100000 };
+    const int sample_count = options->quick ? 100 : 1000;
+    setenv("SDL_VIDEODRIVER", "dummy", 1);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+    renderer_t* ren = renderer_create("bricks_bench", BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT);
+    if (ren == NULL) {
+        fprintf(stderr, "Skipping particle draw benchmarks, no renderer available!\n");
+    }
+    for (size_t c = 0; c < sizeof(particle_counts) / sizeof(particle_counts[0]); c++) {
+        int count = particle_counts[c];
+        particle_pool_t* pool = particle_pool_create(count);
+        bench_samples_t samples;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            // tops up what died in the last sample, so every sample moves a full pool
+            particle_pool_emit_box(pool, 0, 0, BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, COLOR_WHITE, count, 3.0f);
+            double start;
+            bench_begin_sample(&samples, &start);
+            particle_pool_update(pool);
+            bench_end_sample(&samples, start, count);
+        }
+        char variant[32];
+        snprintf(variant, sizeof(variant), "update_%dk", count / 1000);
+        bench_report("particles", variant, &samples, count);
+
+        if (ren != NULL) {
+            // the first frame grows the vertex batch, the samples after it reuse it
+            renderer_draw_particles(ren, pool, 0);
+            bench_samples_init(&samples, sample_count);
+            for (int i = 0; i < sample_count; i++) {
+                particle_pool_emit_box(pool, 0, 0, BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, COLOR_WHITE, count, 3.0f);
+                double start;
+                bench_begin_sample(&samples, &start);
+                renderer_clear(ren, COLOR_BLACK);
+                renderer_draw_particles(ren, pool, 0);
+                renderer_present(ren);
+                bench_end_sample(&samples, start, 1);
+            }
+            snprintf(variant, sizeof(variant), "draw_%dk", count / 1000);
+            bench_report("particles", variant, &samples, 1);
+        }
+        particle_pool_destroy(pool);
+    }
+    renderer_destroy(ren);
+}
+
+// Fill rate of the software renderer in pixels, for rects of a few sizes and whole frames of bricks.
+static void bench_fill(const bench_options_t* options)
+{
+    const int sizes[][2] = { { BENCH_BRICK_WIDTH, BENCH_BRICK_HEIGHT }, { 200, 100 }, { BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT } };
+    const int sample_count = options->quick ? 100 : 1000;
+    renderer_t* ren = renderer_create_software(BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT, NULL);
+    if (ren == NULL)
+        return;
+    Uint32 color = framebuffer_color(COLOR_WHITE);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int width = sizes[s][0];
+        int height = sizes[s][1];
+        // as many rects as make up one frame's worth of pixels, spread over the framebuffer
+        int rects = BENCH_WINDOW_WIDTH * BENCH_WINDOW_HEIGHT / (width * height);
+        bench_samples_t samples;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            for (int r = 0; r < rects; r++) {
+                int x = (r * 7 + i) % (BENCH_WINDOW_WIDTH - width + 1);
+                int y = (r * 13) % (BENCH_WINDOW_HEIGHT - height + 1);
+                framebuffer_fill_rect(ren->framebuffer, x, y, width, height, color);
+            }
+            bench_end_sample(&samples, start, rects * width * height);
+        }
+        char variant[32];
+        snprintf(variant, sizeof(variant), "rect_%dx%d", width, height);
+        bench_report("fill", variant, &samples, rects * width * height);
+    }
+
+    level_t* level = level_create_random_level(BENCH_WINDOW_WIDTH, BENCH_WINDOW_HEIGHT);
+    if (level != NULL) {
+        bench_samples_t samples;
+        bench_samples_init(&samples, sample_count);
+        for (int i = 0; i < sample_count; i++) {
+            double start;
+            bench_begin_sample(&samples, &start);
+            renderer_clear(ren, COLOR_BLACK);
+            renderer_begin_rects(ren);
+            for (int b = 0; b < level->brick_count; b++) {
+                renderer_push_rect(ren, level->x[b], level->y[b], level->width[b], level->height[b], level_brick_color(level, b));
+            }
+            renderer_flush_rects(ren);
+            renderer_present(ren);
+            bench_end_sample(&samples, start, 1);
+        }
+        bench_report("fill", "frame_random", &samples, 1);
+        level_destroy(level);
+    }
+    renderer_destroy(ren);
+}
+
+static void bench_first_frame(renderer_t* ren, const level_t* level)
+{
+    renderer_clear(ren, COLOR_BLACK);
+    renderer_begin_rects(ren);
+    for (int b = 0; b < level->brick_count; b++) {
+        renderer_push_rect(ren, level->x[b], level->y[b], level->width[b], level->height[b], level_brick_color(level, b));
+    }
+    renderer_flush_rects(ren);
+    renderer_draw_static_text(ren, "Lives: 10", 10, 10, COLOR_WHITE);
+    renderer_present(ren);
+}
+
+static int bench_enabled(const bench_options_t* options, const char* name)
+{
+    return options->filter == NULL || strstr(name, options->filter) != NULL;
+}
+
+static void bench_samples_init(bench_samples_t* samples, int count)
+{
+    samples->ns = malloc(sizeof(double) * count);
+    samples->count = 0;
+    memset(&samples->allocated, 0, sizeof(alloc_stats_t));
+}
+
+static void bench_begin_sample(bench_samples_t* samples, double* start)
+{
+    samples->start = alloc_stats_get();
+    *start = clock_seconds();
+}
+
+static void bench_end_sample(bench_samples_t* samples, double start, int ops)
+{
+    double elapsed = clock_seconds() - start;
+    alloc_stats_t now = alloc_stats_get();
+    samples->ns[samples->count++] = elapsed * 1e9 / ops;
+    samples->allocated.allocations += now.allocations - samples->start.allocations;
+    samples->allocated.bytes += now.bytes - samples->start.bytes;
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static double percentile(const double* sorted, int count, double q)
+{
+    return sorted[(int)((count - 1) * q + 0.5)];
+}
+
+static void bench_report(const char* name, const char* variant, bench_samples_t* samples, int ops_per_sample)
+{
+    int n = samples->count;
+    if (n == 0) {
+        free(samples->ns);
+        return;
+    }
+    double total = 0;
+    for (int i = 0; i < n; i++) {
+        total += samples->ns[i];
+    }
+    qsort(samples->ns, n, sizeof(double), compare_doubles);
+    double ops = (double)n * ops_per_sample;
+
+    printf("{\"bench\":\"%s\",\"variant\":\"%s\",\"samples\":%d,\"ops_per_sample\":%d,"
+           "\"ns_per_op\":%.1f,\"ops_per_ms\":%.1f,\"min_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,",
+        name, variant, n, ops_per_sample, total / n, 1e6 / (total / n), samples->ns[0], percentile(samples->ns, n, 0.5),
+        percentile(samples->ns, n, 0.9), percentile(samples->ns, n, 0.99), samples->ns[n - 1]);
+    if (alloc_stats_enabled()) {
+        printf("\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f}\n", samples->allocated.allocations / ops, samples->allocated.bytes / ops);
+    } else {
+        printf("\"allocs_per_op\":null,\"bytes_per_op\":null}\n");
+    }
+    fflush(stdout);
+    free(samples->ns);
+}
+
+static int write_level_csv(const char* filename, int rows, int columns, int x_step, int y_step, int life_count)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return FALSE;
+    }
+    for (int i = 0; i < rows; i++) {
+        fprintf(file, "%d;%d;%d;\n", (i % columns) * x_step, (i / columns) * y_step, life_count);
+    }
+    fclose(file);
+    return TRUE;
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "bot.h"
+
+#define BOT_MIN_REACTION 3
+#define BOT_MAX_REACTION 12
+// how far past the paddle edge the bot may aim, making it miss
+#define BOT_SLOPPINESS 12
+#define BOT_DEAD_ZONE 6
+
+static unsigned bot_random(bot_t* bot);
+
+void bot_init(bot_t* bot, unsigned seed)
+{
+    // xorshift never leaves zero
+    bot->state = seed != 0 ? seed : 0x9e3779b9u;
+    bot->aim_offset = 0;
+    bot->target_x = -1;
+    bot->next_look = 0;
+}
+
+// Feeds the keys for the game's current tick into its input.
+void bot_play(bot_t* bot, game_t* game)
+{
+    const ball_set_t* balls = game->balls;
+    const paddle_t* paddle = game->paddle;
+    if (game->tick >= bot->next_look) {
+        int lowest = -1;
+        for (int i = 0; i < balls->count; i++) {
+            if (balls->velocity_y[i] > 0.0f && (lowest < 0 || balls->y[i] > balls->y[lowest]))
+                lowest = i;
+        }
+        if (lowest >= 0) {
+            int reach = paddle->width / 2 + BOT_SLOPPINESS;
+            bot->aim_offset = (int)(bot_random(bot) % (2 * reach + 1)) - reach;
+            bot->target_x = (int)balls->x[lowest] + balls->width / 2 + bot->aim_offset;
+        }
+        bot->next_look = game->tick + BOT_MIN_REACTION + bot_random(bot) % (BOT_MAX_REACTION - BOT_MIN_REACTION + 1);
+    }
+
+    unsigned keys = 0;
+    if (bot->target_x >= 0) {
+        int center = paddle->x + paddle->width / 2;
+        if (center < bot->target_x - BOT_DEAD_ZONE) {
+            keys = 1u << RIGHT;
+        } else if (center > bot->target_x + BOT_DEAD_ZONE) {
+            keys = 1u << LEFT;
+        }
+    }
+    game_hold_keys(game, keys, game->tick);
+}
+
+static unsigned bot_random(bot_t* bot)
+{
+    unsigned x = bot->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bot->state = x;
+    return x;
+}
@@ -26,6 +26,11 @@
 
 #include "types.h"
 
+enum brick_color {
+    BRICK_COLOR_NORMAL, BRICK_COLOR_WEAK, BRICK_COLOR_COUNT
+};
+
+// A copy of one brick's fields; the bricks themselves live in the arrays of level_t.
 typedef struct brick {
     int x, y;
     int width, height;
@@ -33,7 +38,4 @@ typedef struct brick {
     color_t color;
 } brick_t;
 
-brick_t *brick_create(int x, int y, int width, int height, int life_count, color_t color);
-void brick_destroy(brick_t *brick);
-
 #endif //BRICKS_BRICK_H
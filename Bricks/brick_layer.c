@@ -0,0 +1,115 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "brick_layer.h"
+#include "types.h"
+#include <malloc.h>
+#include <stdio.h>
+
+static int brick_layer_watch_events(void* data, SDL_Event* event);
+
+brick_layer_t* brick_layer_create(renderer_t* ren, int width, int height)
+{
+    // the software backend has no textures to render into
+    if (ren->renderer == NULL)
+        return NULL;
+    SDL_Texture* texture = SDL_CreateTexture(ren->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+    if (texture == NULL) {
+        fprintf(stderr, "Failed to create brick layer: %s\n", SDL_GetError());
+        return NULL;
+    }
+    // the layer is opaque and replaces the background
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+    brick_layer_t* layer = malloc(sizeof(brick_layer_t));
+    layer->texture = texture;
+    layer->width = width;
+    layer->height = height;
+    layer->valid = FALSE;
+    layer->patched_rects = 0;
+    SDL_AddEventWatch(brick_layer_watch_events, layer);
+    return layer;
+}
+
+void brick_layer_destroy(brick_layer_t* layer)
+{
+    if (layer == NULL)
+        return;
+    SDL_DelEventWatch(brick_layer_watch_events, layer);
+    SDL_DestroyTexture(layer->texture);
+    free(layer);
+}
+
+// Brings the texture up to date with the level and clears the level's dirty list.
+void brick_layer_update(brick_layer_t* layer, renderer_t* ren, level_t* level)
+{
+    if (layer->valid && !level->dirty_all && level->dirty_count == 0) {
+        layer->patched_rects = 0;
+        return;
+    }
+    SDL_SetRenderTarget(ren->renderer, layer->texture);
+    renderer_begin_rects(ren);
+    if (!layer->valid || level->dirty_all) {
+        renderer_clear(ren, COLOR_BLACK);
+        for (int i = 0; i < level->brick_count; i++) {
+            renderer_push_rect(ren, level->x[i], level->y[i], level->width[i], level->height[i], level_brick_color(level, i));
+        }
+        layer->valid = TRUE;
+        layer->patched_rects = -1;
+    } else {
+        // blank the changed areas, then redraw whatever still covers them
+        SDL_Rect rects[LEVEL_MAX_DIRTY_RECTS];
+        for (int r = 0; r < level->dirty_count; r++) {
+            const level_rect_t* dirty = &level->dirty[r];
+            rects[r] = (SDL_Rect) { dirty->x, dirty->y, dirty->width, dirty->height };
+            int* bricks;
+            int count = grid_query(level->grid, dirty->x, dirty->y, dirty->width, dirty->height, &bricks);
+            for (int i = 0; i < count; i++) {
+                int b = bricks[i];
+                renderer_push_rect(ren, level->x[b], level->y[b], level->width[b], level->height[b], level_brick_color(level, b));
+            }
+        }
+        SDL_SetRenderDrawColor(ren->renderer, COLOR_BLACK.r, COLOR_BLACK.g, COLOR_BLACK.b, COLOR_BLACK.a);
+        SDL_RenderFillRects(ren->renderer, rects, level->dirty_count);
+        layer->patched_rects = level->dirty_count;
+    }
+    renderer_flush_rects(ren);
+    SDL_SetRenderTarget(ren->renderer, NULL);
+    level_clear_dirty(level);
+}
+
+void brick_layer_draw(brick_layer_t* layer, renderer_t* ren, level_t* level)
+{
+    brick_layer_update(layer, ren, level);
+    SDL_Rect rect = { 0, 0, layer->width, layer->height };
+    SDL_RenderCopy(ren->renderer, layer->texture, &rect, &rect);
+}
+
+// Called from whichever thread pushes the event, so it only flips the flag.
+static int brick_layer_watch_events(void* data, SDL_Event* event)
+{
+    brick_layer_t* layer = data;
+    if (event->type == SDL_RENDER_TARGETS_RESET || event->type == SDL_RENDER_DEVICE_RESET) {
+        layer->valid = FALSE;
+    }
+    return 0;
+}
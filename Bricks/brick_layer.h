@@ -0,0 +1,46 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_BRICK_LAYER_H
+#define BRICKS_BRICK_LAYER_H
+
+#include "level.h"
+#include "renderer.h"
+#include <SDL2/SDL.h>
+
+// The brick field rendered once into a texture. Only the parts of the level that changed are
+// redrawn, so a frame costs one texture copy however many bricks there are.
+typedef struct brick_layer {
+    SDL_Texture *texture;
+    int width, height;
+    short valid; // the renderer may throw away what was drawn into target textures
+    int patched_rects; // rects redrawn by the last update, -1 after a full redraw
+} brick_layer_t;
+
+brick_layer_t *brick_layer_create(renderer_t *ren, int width, int height);
+void brick_layer_destroy(brick_layer_t *layer);
+
+void brick_layer_update(brick_layer_t *layer, renderer_t *ren, level_t *level);
+void brick_layer_draw(brick_layer_t *layer, renderer_t *ren, level_t *level);
+
+#endif //BRICKS_BRICK_LAYER_H
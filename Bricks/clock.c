@@ -21,25 +21,19 @@
 // CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
-#include "brick.h"
-#include <stddef.h>
-#include <malloc.h>
+#include "clock.h"
+#include <time.h>
 
-brick_t *brick_create(int x, int y, int width, int height, int life_count, color_t color)
+double clock_seconds(void)
 {
-    brick_t *brick = malloc(sizeof(brick_t));
-    brick->x = x;
-    brick->y = y;
-    brick->width = width;
-    brick->height = height;
-    brick->life_count = life_count;
-    brick->color = color;
-    return brick;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
 }
 
-void brick_destroy(brick_t *brick)
+unsigned long long clock_nanoseconds(void)
 {
-    if (brick == NULL)
-        return;
-    free(brick);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ull + (unsigned long long)now.tv_nsec;
 }
@@ -0,0 +1,70 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "collision.h"
+#include "types.h"
+#include <math.h>
+
+// boxes that already touch count as hit, even if rounding put them a hair into each other
+#define COLLISION_EPSILON 1e-4f
+
+static int collision_axis(float position, float size, float delta, float target, float target_size, float* entry, float* exit);
+
+// Sweeps the box by (dx, dy) against the target and reports the first contact within the move.
+// Boxes that already overlap at the start don't count, the caller has to separate them.
+int collision_sweep(const collision_box_t* box, float dx, float dy, const collision_box_t* target, collision_hit_t* hit)
+{
+    float entry_x, exit_x, entry_y, exit_y;
+    if (!collision_axis(box->x, box->width, dx, target->x, target->width, &entry_x, &exit_x))
+        return FALSE;
+    if (!collision_axis(box->y, box->height, dy, target->y, target->height, &entry_y, &exit_y))
+        return FALSE;
+    float entry = entry_x > entry_y ? entry_x : entry_y;
+    float exit = exit_x < exit_y ? exit_x : exit_y;
+    if (entry >= exit || entry < -COLLISION_EPSILON || entry > 1.0f)
+        return FALSE;
+    hit->time = entry > 0.0f ? entry : 0.0f;
+    hit->normal_x = entry_x == entry ? (dx > 0 ? -1 : 1) : 0;
+    hit->normal_y = entry_y == entry ? (dy > 0 ? -1 : 1) : 0;
+    return TRUE;
+}
+
+// Computes when the box starts and stops overlapping the target along one axis.
+static int collision_axis(float position, float size, float delta, float target, float target_size, float* entry, float* exit)
+{
+    if (delta == 0.0f) {
+        if (position + size <= target || position >= target + target_size)
+            return FALSE;
+        *entry = -INFINITY;
+        *exit = INFINITY;
+        return TRUE;
+    }
+    if (delta > 0.0f) {
+        *entry = (target - (position + size)) / delta;
+        *exit = (target + target_size - position) / delta;
+    } else {
+        *entry = (target + target_size - position) / delta;
+        *exit = (target - (position + size)) / delta;
+    }
+    return TRUE;
+}
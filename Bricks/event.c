@@ -22,34 +22,33 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "event.h"
+#include "types.h"
 #include <SDL2/SDL.h>
 
-event_t* event_poll()
+unsigned event_poll(input_t* input)
 {
     SDL_Event sdl_event;
-    event_t* event = malloc(sizeof(event_t));
-    event->kind = NONE;
+    unsigned events = 0;
     while (SDL_PollEvent(&sdl_event)) {
         if (sdl_event.type == SDL_QUIT) {
-            event->kind = QUIT;
-        } else if (sdl_event.type == SDL_KEYDOWN) {
-            event->kind = KEY;
+            events |= EVENT_QUIT;
+        } else if (sdl_event.type == SDL_KEYDOWN && !sdl_event.key.repeat && sdl_event.key.keysym.scancode == SDL_SCANCODE_F3) {
+            events ^= EVENT_TOGGLE_PROFILER;
+        } else if (sdl_event.type == SDL_KEYDOWN && !sdl_event.key.repeat && sdl_event.key.keysym.scancode == SDL_SCANCODE_F5) {
+            events |= EVENT_SAVE_STATE;
+        } else if (sdl_event.type == SDL_KEYDOWN && !sdl_event.key.repeat && sdl_event.key.keysym.scancode == SDL_SCANCODE_F9) {
+            events |= EVENT_LOAD_STATE;
+        } else if ((sdl_event.type == SDL_KEYDOWN || sdl_event.type == SDL_KEYUP) && !sdl_event.key.repeat) {
+            short pressed = sdl_event.type == SDL_KEYDOWN;
             if (sdl_event.key.keysym.scancode == SDL_SCANCODE_LEFT) {
-                event->key = LEFT;
+                input_push(input, LEFT, pressed, sdl_event.key.timestamp);
             } else if (sdl_event.key.keysym.scancode == SDL_SCANCODE_RIGHT) {
-                event->key = RIGHT;
-            } else {
-                event->kind = NONE;
+                input_push(input, RIGHT, pressed, sdl_event.key.timestamp);
             }
         }
     }
-    return event;
-}
-
-void event_destroy(event_t* event)
-{
-    if (event == NULL) {
-        return;
+    if (SDL_GetKeyboardState(NULL)[SDL_SCANCODE_BACKSPACE]) {
+        events |= EVENT_REWIND;
     }
-    free(event);
+    return events;
 }
@@ -24,20 +24,16 @@
 #ifndef BRICKS_EVENT_H
 #define BRICKS_EVENT_H
 
-enum key {
-    LEFT, RIGHT
-};
+#include "input.h"
 
-enum event_kind {
-    QUIT, KEY, NONE
-};
+#define EVENT_QUIT 0x1
+#define EVENT_TOGGLE_PROFILER 0x2
+#define EVENT_SAVE_STATE 0x4
+#define EVENT_LOAD_STATE 0x8
+#define EVENT_REWIND 0x10 // held rather than pressed
 
-typedef struct event {
-    enum key key;
-    enum event_kind kind;
-} event_t;
-
-event_t* event_poll();
-void event_destroy(event_t *event);
+// Drains the SDL queue into the input ring. Returns the EVENT_* flags for everything else that
+// happened.
+unsigned event_poll(input_t *input);
 
 #endif //BRICKS_EVENT_H
@@ -0,0 +1,203 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "framebuffer.h"
+#include <SDL2/SDL_image.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FRAMEBUFFER_HAVE_AVX2
+#endif
+
+static void framebuffer_fill_span(Uint32* span, int begin, int end, Uint32 color);
+static int framebuffer_fill_span_scalar(Uint32* span, int begin, int end, Uint32 color);
+#if defined(__SSE2__)
+static int framebuffer_fill_span_sse2(Uint32* span, int begin, int end, Uint32 color);
+#endif
+#if defined(FRAMEBUFFER_HAVE_AVX2)
+static int framebuffer_fill_span_avx2(Uint32* span, int begin, int end, Uint32 color);
+#endif
+static void framebuffer_blend_glyph(framebuffer_t* framebuffer, const text_font_t* font, const SDL_Rect* glyph, int x, int y, color_t color);
+
+framebuffer_t* framebuffer_create(int width, int height)
+{
+    framebuffer_t* framebuffer = malloc(sizeof(framebuffer_t));
+    // 32 byte aligned, so the rows of a framebuffer whose width is a multiple of 8 start where an AVX2 store can
+    framebuffer->pixels = memalign(32, sizeof(Uint32) * width * height);
+    if (framebuffer->pixels == NULL) {
+        fprintf(stderr, "Failed to allocate a %dx%d framebuffer!\n", width, height);
+        free(framebuffer);
+        return NULL;
+    }
+    framebuffer->width = width;
+    framebuffer->height = height;
+    framebuffer_clear(framebuffer, framebuffer_color(COLOR_BLACK));
+    return framebuffer;
+}
+
+void framebuffer_destroy(framebuffer_t* framebuffer)
+{
+    if (framebuffer == NULL)
+        return;
+    free(framebuffer->pixels);
+    free(framebuffer);
+}
+
+// the framebuffer has nothing behind it to blend with, so its alpha is always opaque
+Uint32 framebuffer_color(color_t color)
+{
+    return 0xff000000u | (Uint32)(color.r & 0xff) << 16 | (Uint32)(color.g & 0xff) << 8 | (Uint32)(color.b & 0xff);
+}
+
+void framebuffer_fill_rect(framebuffer_t* framebuffer, int x, int y, int width, int height, Uint32 color)
+{
+    int left = x < 0 ? 0 : x;
+    int top = y < 0 ? 0 : y;
+    int right = x + width > framebuffer->width ? framebuffer->width : x + width;
+    int bottom = y + height > framebuffer->height ? framebuffer->height : y + height;
+    if (left >= right || top >= bottom)
+        return;
+    for (int row = top; row < bottom; row++) {
+        framebuffer_fill_span(framebuffer->pixels + (size_t)row * framebuffer->width, left, right, color);
+    }
+}
+
+void framebuffer_clear(framebuffer_t* framebuffer, Uint32 color)
+{
+    // the rows follow each other without padding, so the whole buffer is one span
+    framebuffer_fill_span(framebuffer->pixels, 0, framebuffer->width * framebuffer->height, color);
+}
+
+void framebuffer_draw_text(framebuffer_t* framebuffer, const text_font_t* font, const char* str, int x, int y, color_t color)
+{
+    int pen_x = x;
+    Uint16 previous = 0;
+    for (const char* c = str; *c != '\0'; c++) {
+        unsigned char ch = (unsigned char)*c;
+        if (ch < TEXT_FIRST_GLYPH || ch > TEXT_LAST_GLYPH) {
+            ch = '?';
+        }
+        const glyph_t* glyph = &font->glyphs[ch - TEXT_FIRST_GLYPH];
+        if (previous != 0) {
+            pen_x += TTF_GetFontKerningSizeGlyphs(font->font, previous, ch);
+        }
+        framebuffer_blend_glyph(framebuffer, font, &glyph->atlas_rect, pen_x, y, color);
+        pen_x += glyph->advance;
+        previous = ch;
+    }
+}
+
+int framebuffer_save_png(const framebuffer_t* framebuffer, const char* filename)
+{
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom(framebuffer->pixels, framebuffer->width, framebuffer->height, 32,
+        framebuffer->width * (int)sizeof(Uint32), SDL_PIXELFORMAT_ARGB8888);
+    if (surface == NULL) {
+        fprintf(stderr, "Failed to wrap the framebuffer in a surface! %s\n", SDL_GetError());
+        return FALSE;
+    }
+    int saved = IMG_SavePNG(surface, filename) == 0;
+    if (!saved) {
+        fprintf(stderr, "Failed to write %s! %s\n", filename, IMG_GetError());
+    }
+    SDL_FreeSurface(surface);
+    return saved;
+}
+
+static void framebuffer_blend_glyph(framebuffer_t* framebuffer, const text_font_t* font, const SDL_Rect* glyph, int x, int y, color_t color)
+{
+    int left = x < 0 ? -x : 0;
+    int top = y < 0 ? -y : 0;
+    int right = x + glyph->w > framebuffer->width ? framebuffer->width - x : glyph->w;
+    int bottom = y + glyph->h > framebuffer->height ? framebuffer->height - y : glyph->h;
+    for (int row = top; row < bottom; row++) {
+        const Uint32* src = font->pixels + (size_t)(glyph->y + row) * font->atlas_width + glyph->x;
+        Uint32* dst = framebuffer->pixels + (size_t)(y + row) * framebuffer->width + x;
+        for (int column = left; column < right; column++) {
+            // the glyphs are white, so their alpha is all that's left once they are tinted
+            Uint32 alpha = src[column] >> 24;
+            if (alpha == 0)
+                continue;
+            Uint32 pixel = dst[column];
+            Uint32 r = ((Uint32)color.r * alpha + ((pixel >> 16) & 0xff) * (255 - alpha)) / 255;
+            Uint32 g = ((Uint32)color.g * alpha + ((pixel >> 8) & 0xff) * (255 - alpha)) / 255;
+            Uint32 b = ((Uint32)color.b * alpha + (pixel & 0xff) * (255 - alpha)) / 255;
+            dst[column] = 0xff000000u | r << 16 | g << 8 | b;
+        }
+    }
+}
+
+static void framebuffer_fill_span(Uint32* span, int begin, int end, Uint32 color)
+{
+#if defined(FRAMEBUFFER_HAVE_AVX2)
+    if (end - begin >= 8 && __builtin_cpu_supports("avx2"))
+        begin = framebuffer_fill_span_avx2(span, begin, end, color);
+#endif
+#if defined(__SSE2__)
+    if (end - begin >= 4)
+        begin = framebuffer_fill_span_sse2(span, begin, end, color);
+#endif
+    framebuffer_fill_span_scalar(span, begin, end, color);
+}
+
+// The span kernels all do the same thing and return the index of the first pixel they didn't
+// get to, which the narrower ones pick up.
+static int framebuffer_fill_span_scalar(Uint32* span, int begin, int end, Uint32 color)
+{
+    for (int i = begin; i < end; i++) {
+        span[i] = color;
+    }
+    return end;
+}
+
+#if defined(__SSE2__)
+static int framebuffer_fill_span_sse2(Uint32* span, int begin, int end, Uint32 color)
+{
+    const __m128i value = _mm_set1_epi32((int)color);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        _mm_storeu_si128((__m128i*)(span + i), value);
+    }
+    return i;
+}
+#endif
+
+#if defined(FRAMEBUFFER_HAVE_AVX2)
+__attribute__((target("avx2"))) static int framebuffer_fill_span_avx2(Uint32* span, int begin, int end, Uint32 color)
+{
+    const __m256i value = _mm256_set1_epi32((int)color);
+    int i = begin;
+    // unaligned stores that straddle cache lines cost twice, so walk up to the next 32 bytes first
+    while (i < end && ((uintptr_t)(span + i) & 31) != 0) {
+        span[i++] = color;
+    }
+    for (; i + 8 <= end; i += 8) {
+        _mm256_store_si256((__m256i*)(span + i), value);
+    }
+    return i;
+}
+#endif
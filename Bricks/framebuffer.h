@@ -0,0 +1,48 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_FRAMEBUFFER_H
+#define BRICKS_FRAMEBUFFER_H
+
+#include "text.h"
+#include "types.h"
+#include <SDL2/SDL.h>
+
+// Pixels in memory for the software renderer, ARGB8888 in rows of width pixels.
+typedef struct framebuffer {
+    Uint32 *pixels;
+    int width, height;
+} framebuffer_t;
+
+framebuffer_t *framebuffer_create(int width, int height);
+void framebuffer_destroy(framebuffer_t *framebuffer);
+
+Uint32 framebuffer_color(color_t color);
+// Rects are clipped to the framebuffer and filled opaque, one span per row.
+void framebuffer_fill_rect(framebuffer_t *framebuffer, int x, int y, int width, int height, Uint32 color);
+void framebuffer_clear(framebuffer_t *framebuffer, Uint32 color);
+// Blends the string in from the font's glyph atlas, tinted like text_draw does it.
+void framebuffer_draw_text(framebuffer_t *framebuffer, const text_font_t *font, const char *str, int x, int y, color_t color);
+int framebuffer_save_png(const framebuffer_t *framebuffer, const char *filename);
+
+#endif //BRICKS_FRAMEBUFFER_H
@@ -0,0 +1,162 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "game.h"
+#include "sim.h"
+#include "types.h"
+#include <malloc.h>
+#include <math.h>
+#include <stddef.h>
+
+static const int PADDLE_MOV_AMOUNT = 10;
+static const int PADDLE_WIDTH = 100;
+static const int PADDLE_HEIGHT = 20;
+static const int PADDLE_START_X = GAME_WIDTH / 2 - PADDLE_WIDTH / 2;
+static const int PADDLE_START_Y = GAME_HEIGHT - 30;
+
+static const int BALL_MOV_AMOUNT = 5;
+static const int BALL_WIDTH = 10;
+static const int BALL_START_X = GAME_WIDTH / 2 - BALL_WIDTH / 2;
+static const int BALL_START_Y = GAME_HEIGHT / 2 - BALL_WIDTH / 2;
+
+static void (*const paddle_mov[KEY_COUNT])(paddle_t*, int) = { paddle_move_left, paddle_move_right };
+
+static void game_spawn_balls(ball_set_t* balls, int count);
+static void game_scroll(game_t* game);
+static void game_move_view(game_t* game, int dy);
+
+// The game takes over the level and destroys it with itself.
+game_t* game_create(level_t* level, int ball_count)
+{
+    game_t* game = calloc(1, sizeof(game_t));
+    game->level = level;
+    game->paddle = paddle_create(PADDLE_START_X, PADDLE_START_Y, PADDLE_WIDTH, PADDLE_HEIGHT, GAME_WIDTH, COLOR_WHITE);
+    game->balls = ball_set_create(ball_count, BALL_WIDTH, BALL_WIDTH, GAME_WIDTH, GAME_HEIGHT, COLOR_WHITE);
+    ball_set_spawn_point(game->balls, BALL_START_X, BALL_START_Y, BALL_MOV_AMOUNT, -BALL_MOV_AMOUNT);
+    game_spawn_balls(game->balls, ball_count);
+    input_reset(&game->input);
+    game->life_count = GAME_LIFE_COUNT;
+    return game;
+}
+
+game_t* game_create_streamed(level_stream_t* stream, int ball_count)
+{
+    game_t* game = game_create(level_create_empty(), ball_count);
+    game->stream = stream;
+    // the first screen is loaded before the game starts, the rest streams in while it runs
+    game_move_view(game, level_stream_start_y(stream, GAME_HEIGHT));
+    game_move_view(game, level_stream_update(stream, game->level, game->view_y, GAME_HEIGHT));
+    return game;
+}
+
+void game_destroy(game_t* game)
+{
+    if (game == NULL)
+        return;
+    level_stream_close(game->stream);
+    level_destroy(game->level);
+    paddle_destroy(game->paddle);
+    ball_set_destroy(game->balls);
+    free(game);
+}
+
+// Presses and releases keys so that exactly the ones in the mask are held, for inputs that
+// know the state they want rather than the transitions.
+void game_hold_keys(game_t* game, unsigned keys, unsigned timestamp)
+{
+    for (int key = 0; key < KEY_COUNT; key++) {
+        short pressed = (keys & (1u << key)) != 0;
+        if (pressed != input_active(&game->input, key)) {
+            input_push(&game->input, key, pressed, timestamp);
+        }
+    }
+}
+
+void game_tick(game_t* game, unsigned input_time)
+{
+    input_update(&game->input, input_time);
+    game_step(game, input_keys(&game->input));
+}
+
+// Plays one tick with the keys in the mask, whatever the input says. Replays drive the game with it.
+void game_step(game_t* game, unsigned keys)
+{
+    game->keys = keys;
+    for (int key = 0; key < KEY_COUNT; key++) {
+        if (keys & (1u << key)) {
+            (*paddle_mov[key])(game->paddle, PADDLE_MOV_AMOUNT);
+        }
+    }
+    if (game->stream != NULL) {
+        game_scroll(game);
+    }
+    game->life_count -= sim_tick(game->level, game->balls, game->paddle);
+    game->tick++;
+}
+
+int game_lost(const game_t* game)
+{
+    return game->life_count <= 0;
+}
+
+// A streamed level is only cleared once the view reached its top.
+int game_cleared(const game_t* game)
+{
+    if (game->stream != NULL && game->stream->origin_y + game->view_y > 0)
+        return FALSE;
+    return game->level->brick_count == 0;
+}
+
+// A single ball leaves from the spawn point as before, more of them fan out upwards from it.
+static void game_spawn_balls(ball_set_t* balls, int count)
+{
+    ball_set_reset(balls);
+    if (count == 1)
+        return;
+    balls->count = 0;
+    double speed = sqrt(2.0) * BALL_MOV_AMOUNT;
+    for (int i = 0; i < count; i++) {
+        double angle = M_PI / 6 + (M_PI * 2 / 3) * (i + 0.5) / count;
+        ball_set_add(balls, balls->spawn_x, balls->spawn_y, (float)(speed * cos(angle)), (float)(-speed * sin(angle)));
+    }
+}
+
+static void game_scroll(game_t* game)
+{
+    int world_y = game->stream->origin_y + game->view_y;
+    if (world_y > 0) {
+        game_move_view(game, world_y < GAME_SCROLL_SPEED ? -world_y : -GAME_SCROLL_SPEED);
+    }
+    game_move_view(game, level_stream_update(game->stream, game->level, game->view_y, GAME_HEIGHT));
+}
+
+// Moves the view and with it the paddle and the balls, which live in screen space.
+static void game_move_view(game_t* game, int dy)
+{
+    if (dy == 0)
+        return;
+    game->view_y += dy;
+    game->paddle->y += dy;
+    game->balls->top = (float)game->view_y;
+    ball_set_translate(game->balls, (float)dy);
+}
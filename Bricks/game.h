@@ -0,0 +1,63 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_GAME_H
+#define BRICKS_GAME_H
+
+#include "ball.h"
+#include "input.h"
+#include "level.h"
+#include "level_stream.h"
+#include "paddle.h"
+
+#define GAME_WIDTH 800
+#define GAME_HEIGHT 600
+#define GAME_LIFE_COUNT 10
+// pixels per tick the view of a streamed level scrolls up
+#define GAME_SCROLL_SPEED 1
+
+// Everything one running game owns, so several of them can exist side by side.
+typedef struct game {
+    level_t *level;
+    ball_set_t *balls;
+    paddle_t *paddle;
+    input_t input;
+    unsigned keys; // the keys the last tick was played with
+    int life_count;
+    long tick;
+    level_stream_t *stream; // only for streamed levels, which scroll
+    int view_y; // top edge of the view in level coordinates
+} game_t;
+
+game_t *game_create(level_t *level, int ball_count);
+// Starts at the bottom of a streamed level; the game takes over the stream.
+game_t *game_create_streamed(level_stream_t *stream, int ball_count);
+void game_destroy(game_t *game);
+
+void game_hold_keys(game_t *game, unsigned keys, unsigned timestamp);
+void game_tick(game_t *game, unsigned input_time);
+void game_step(game_t *game, unsigned keys);
+int game_lost(const game_t *game);
+int game_cleared(const game_t *game);
+
+#endif //BRICKS_GAME_H
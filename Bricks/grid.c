@@ -0,0 +1,302 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "grid.h"
+#include <limits.h>
+#include <malloc.h>
+#include <stddef.h>
+#include <string.h>
+
+// keeps sparse levels with far apart bricks from allocating a huge, mostly empty grid
+#define GRID_MAX_CELLS_PER_ITEM 4
+
+typedef struct cell_range {
+    int first_column, last_column;
+    int first_row, last_row;
+} cell_range_t;
+
+static void* grid_alloc(arena_t* arena, size_t size);
+static void* grid_alloc_zeroed(arena_t* arena, size_t size);
+static void grid_free(const grid_t* grid, void* ptr);
+static int floor_div(int a, int b);
+static int grid_cells(const grid_t* grid, int x, int y, int width, int height, cell_range_t* range);
+
+grid_t* grid_create(arena_t* arena, const int* x, const int* y, const int* width, const int* height, int count, int cell_size)
+{
+    grid_t* grid = grid_alloc_zeroed(arena, sizeof(grid_t));
+    grid->arena = arena;
+    grid->item_count = count;
+    grid->cell_size = cell_size;
+    grid->results = grid_alloc(arena, sizeof(int) * (count > 0 ? count : 1));
+    grid->visited = grid_alloc_zeroed(arena, sizeof(unsigned int) * (count > 0 ? count : 1));
+
+    int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+    for (int i = 0; i < count; i++) {
+        if (x[i] < min_x)
+            min_x = x[i];
+        if (y[i] < min_y)
+            min_y = y[i];
+        if (x[i] + width[i] > max_x)
+            max_x = x[i] + width[i];
+        if (y[i] + height[i] > max_y)
+            max_y = y[i] + height[i];
+    }
+    if (count == 0) {
+        grid->cell_start = grid_alloc_zeroed(arena, sizeof(int));
+        grid->cell_count = grid_alloc_zeroed(arena, sizeof(int));
+        grid->entries = grid_alloc_zeroed(arena, sizeof(int));
+        return grid;
+    }
+
+    grid->origin_x = min_x;
+    grid->origin_y = min_y;
+    long long cells;
+    for (;;) {
+        grid->columns = (max_x - min_x) / grid->cell_size + 1;
+        grid->rows = (max_y - min_y) / grid->cell_size + 1;
+        cells = (long long)grid->columns * grid->rows;
+        if (cells <= (long long)count * GRID_MAX_CELLS_PER_ITEM + 16)
+            break;
+        grid->cell_size *= 2;
+    }
+    grid->cell_start = grid_alloc_zeroed(arena, sizeof(int) * (cells + 1));
+    grid->cell_count = grid_alloc_zeroed(arena, sizeof(int) * cells);
+
+    // first pass counts the entries per cell, second pass fills the slices
+    cell_range_t range;
+    for (int i = 0; i < count; i++) {
+        if (!grid_cells(grid, x[i], y[i], width[i], height[i], &range))
+            continue;
+        for (int row = range.first_row; row <= range.last_row; row++) {
+            for (int column = range.first_column; column <= range.last_column; column++) {
+                grid->cell_start[row * grid->columns + column + 1]++;
+            }
+        }
+    }
+    for (long long cell = 0; cell < cells; cell++) {
+        grid->cell_start[cell + 1] += grid->cell_start[cell];
+    }
+    grid->entries = grid_alloc(arena, sizeof(int) * (grid->cell_start[cells] > 0 ? grid->cell_start[cells] : 1));
+    for (int i = 0; i < count; i++) {
+        if (!grid_cells(grid, x[i], y[i], width[i], height[i], &range))
+            continue;
+        for (int row = range.first_row; row <= range.last_row; row++) {
+            for (int column = range.first_column; column <= range.last_column; column++) {
+                int cell = row * grid->columns + column;
+                grid->entries[grid->cell_start[cell] + grid->cell_count[cell]++] = i;
+            }
+        }
+    }
+    return grid;
+}
+
+grid_t* grid_wrap(arena_t* arena, int count, int origin_x, int origin_y, int cell_size, int columns, int rows, int* cell_start, int* cell_count, int* entries)
+{
+    grid_t* grid = grid_alloc_zeroed(arena, sizeof(grid_t));
+    grid->arena = arena;
+    grid->item_count = count;
+    grid->origin_x = origin_x;
+    grid->origin_y = origin_y;
+    grid->cell_size = cell_size;
+    grid->columns = columns;
+    grid->rows = rows;
+    grid->cell_start = cell_start;
+    grid->cell_count = cell_count;
+    grid->entries = entries;
+    grid->results = grid_alloc(arena, sizeof(int) * (count > 0 ? count : 1));
+    grid->visited = grid_alloc_zeroed(arena, sizeof(unsigned int) * (count > 0 ? count : 1));
+    return grid;
+}
+
+void grid_own_cells(grid_t* grid)
+{
+    size_t cells = (size_t)grid->columns * grid->rows;
+    size_t entries = (size_t)grid->cell_start[cells];
+    int* cell_start = grid_alloc(grid->arena, sizeof(int) * (cells + 1));
+    int* cell_count = grid_alloc(grid->arena, sizeof(int) * (cells > 0 ? cells : 1));
+    int* entry_copy = grid_alloc(grid->arena, sizeof(int) * (entries > 0 ? entries : 1));
+    memcpy(cell_start, grid->cell_start, sizeof(int) * (cells + 1));
+    memcpy(cell_count, grid->cell_count, sizeof(int) * cells);
+    memcpy(entry_copy, grid->entries, sizeof(int) * entries);
+    grid->cell_start = cell_start;
+    grid->cell_count = cell_count;
+    grid->entries = entry_copy;
+}
+
+void grid_destroy(grid_t* grid)
+{
+    if (grid == NULL)
+        return;
+    grid_free(grid, grid->cell_start);
+    grid_free(grid, grid->cell_count);
+    grid_free(grid, grid->entries);
+    grid_free(grid, grid->results);
+    grid_free(grid, grid->visited);
+    grid_free(grid, grid);
+}
+
+void grid_remove(grid_t* grid, int index, int x, int y, int width, int height)
+{
+    cell_range_t range;
+    if (!grid_cells(grid, x, y, width, height, &range))
+        return;
+    for (int row = range.first_row; row <= range.last_row; row++) {
+        for (int column = range.first_column; column <= range.last_column; column++) {
+            int cell = row * grid->columns + column;
+            int* slice = grid->entries + grid->cell_start[cell];
+            for (int i = 0; i < grid->cell_count[cell]; i++) {
+                if (slice[i] == index) {
+                    slice[i] = slice[--grid->cell_count[cell]];
+                    break;
+                }
+            }
+        }
+    }
+}
+
+int grid_insert(grid_t* grid, int index, int x, int y, int width, int height)
+{
+    if (index >= grid->item_count)
+        return FALSE;
+    cell_range_t range;
+    if (!grid_cells(grid, x, y, width, height, &range))
+        return FALSE;
+    // grid_cells clamps, so a box sticking out of the grid would go missing from the cut off cells
+    if (x < grid->origin_x || y < grid->origin_y
+        || floor_div(x + width - grid->origin_x, grid->cell_size) >= grid->columns
+        || floor_div(y + height - grid->origin_y, grid->cell_size) >= grid->rows)
+        return FALSE;
+    for (int row = range.first_row; row <= range.last_row; row++) {
+        for (int column = range.first_column; column <= range.last_column; column++) {
+            int cell = row * grid->columns + column;
+            if (grid->cell_start[cell] + grid->cell_count[cell] == grid->cell_start[cell + 1])
+                return FALSE;
+        }
+    }
+    for (int row = range.first_row; row <= range.last_row; row++) {
+        for (int column = range.first_column; column <= range.last_column; column++) {
+            int cell = row * grid->columns + column;
+            grid->entries[grid->cell_start[cell] + grid->cell_count[cell]++] = index;
+        }
+    }
+    return TRUE;
+}
+
+void grid_rename(grid_t* grid, int from, int to, int x, int y, int width, int height)
+{
+    cell_range_t range;
+    if (!grid_cells(grid, x, y, width, height, &range))
+        return;
+    for (int row = range.first_row; row <= range.last_row; row++) {
+        for (int column = range.first_column; column <= range.last_column; column++) {
+            int cell = row * grid->columns + column;
+            int* slice = grid->entries + grid->cell_start[cell];
+            for (int i = 0; i < grid->cell_count[cell]; i++) {
+                if (slice[i] == from) {
+                    slice[i] = to;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void grid_translate(grid_t* grid, int dx, int dy)
+{
+    grid->origin_x += dx;
+    grid->origin_y += dy;
+}
+
+int grid_query(grid_t* grid, int x, int y, int width, int height, int** results)
+{
+    *results = grid->results;
+    cell_range_t range;
+    if (!grid_cells(grid, x, y, width, height, &range))
+        return 0;
+
+    // bricks spanning several cells are reported once, tracked with a per query stamp
+    if (++grid->query_stamp == 0) {
+        memset(grid->visited, 0, sizeof(unsigned int) * grid->item_count);
+        grid->query_stamp = 1;
+    }
+    int count = 0;
+    for (int row = range.first_row; row <= range.last_row; row++) {
+        for (int column = range.first_column; column <= range.last_column; column++) {
+            int cell = row * grid->columns + column;
+            const int* slice = grid->entries + grid->cell_start[cell];
+            for (int i = 0; i < grid->cell_count[cell]; i++) {
+                int index = slice[i];
+                if (grid->visited[index] != grid->query_stamp) {
+                    grid->visited[index] = grid->query_stamp;
+                    grid->results[count++] = index;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+static void* grid_alloc(arena_t* arena, size_t size)
+{
+    return arena != NULL ? arena_alloc(arena, size) : malloc(size);
+}
+
+static void* grid_alloc_zeroed(arena_t* arena, size_t size)
+{
+    return arena != NULL ? arena_alloc_zeroed(arena, size) : calloc(1, size);
+}
+
+// memory from an arena goes away with the arena
+static void grid_free(const grid_t* grid, void* ptr)
+{
+    if (grid->arena == NULL) {
+        free(ptr);
+    }
+}
+
+static int floor_div(int a, int b)
+{
+    int q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+static int grid_cells(const grid_t* grid, int x, int y, int width, int height, cell_range_t* range)
+{
+    if (grid->columns == 0 || grid->rows == 0)
+        return FALSE;
+    range->first_column = floor_div(x - grid->origin_x, grid->cell_size);
+    range->first_row = floor_div(y - grid->origin_y, grid->cell_size);
+    range->last_column = floor_div(x + width - grid->origin_x, grid->cell_size);
+    range->last_row = floor_div(y + height - grid->origin_y, grid->cell_size);
+    if (range->last_column < 0 || range->last_row < 0 || range->first_column >= grid->columns || range->first_row >= grid->rows)
+        return FALSE;
+    if (range->first_column < 0)
+        range->first_column = 0;
+    if (range->first_row < 0)
+        range->first_row = 0;
+    if (range->last_column >= grid->columns)
+        range->last_column = grid->columns - 1;
+    if (range->last_row >= grid->rows)
+        range->last_row = grid->rows - 1;
+    return TRUE;
+}
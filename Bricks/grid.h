@@ -0,0 +1,67 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_GRID_H
+#define BRICKS_GRID_H
+
+#include "arena.h"
+#include "types.h"
+
+// Uniform grid over the bricks of a level. Every cell holds the indices of the bricks overlapping it,
+// packed into one entry array with a fixed slice per cell. Items are given as parallel box arrays.
+typedef struct grid {
+    arena_t* arena;
+    int origin_x, origin_y;
+    int cell_size;
+    int columns, rows;
+    int* cell_start;
+    int* cell_count;
+    int* entries;
+    int item_count;
+    int* results;
+    unsigned int* visited;
+    unsigned int query_stamp;
+} grid_t;
+
+// The grid's memory comes from the arena when one is given, otherwise from the heap.
+grid_t* grid_create(arena_t* arena, const int* x, const int* y, const int* width, const int* height, int count, int cell_size);
+// Builds a grid around cell arrays laid out as grid_create leaves them, used in place. They are freed
+// with the grid when no arena is given.
+grid_t* grid_wrap(arena_t* arena, int count, int origin_x, int origin_y, int cell_size, int columns, int rows, int* cell_start, int* cell_count, int* entries);
+// Copies the cell arrays into the grid's own memory, for a wrapped grid that outlives them.
+void grid_own_cells(grid_t* grid);
+void grid_destroy(grid_t* grid);
+
+void grid_remove(grid_t* grid, int index, int x, int y, int width, int height);
+// Adds an item into the room left by removed ones. Fails without changing the grid when a cell is full,
+// the box lies outside of the grid or the index is beyond the grid's item count; rebuild the grid then.
+int grid_insert(grid_t* grid, int index, int x, int y, int width, int height);
+// Changes the index stored for the item at the given box from `from` to `to`.
+void grid_rename(grid_t* grid, int from, int to, int x, int y, int width, int height);
+// Moves all items at once, for items that moved together.
+void grid_translate(grid_t* grid, int dx, int dy);
+// Returns the number of distinct items overlapping the given box, their indices are stored in *results.
+// The result buffer belongs to the grid and stays valid until the next query.
+int grid_query(grid_t* grid, int x, int y, int width, int height, int** results);
+
+#endif //BRICKS_GRID_H
@@ -0,0 +1,81 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "input.h"
+#include "types.h"
+#include <string.h>
+
+static void input_apply(input_t* input, const input_event_t* event);
+
+void input_reset(input_t* input)
+{
+    memset(input, 0, sizeof(input_t));
+}
+
+void input_push(input_t* input, enum key key, short pressed, unsigned timestamp)
+{
+    if (input->tail - input->head == INPUT_RING_SIZE) {
+        // full: apply the oldest transition early rather than lose it
+        input_apply(input, &input->events[input->head++ & (INPUT_RING_SIZE - 1)]);
+    }
+    input_event_t* event = &input->events[input->tail++ & (INPUT_RING_SIZE - 1)];
+    event->timestamp = timestamp;
+    event->key = key;
+    event->pressed = pressed;
+}
+
+// Applies every event up to the timestamp. Keys pressed since the previous update stay active
+// for this tick even if they were released again already.
+void input_update(input_t* input, unsigned timestamp)
+{
+    while (input->head != input->tail) {
+        input_event_t* event = &input->events[input->head & (INPUT_RING_SIZE - 1)];
+        if ((int)(event->timestamp - timestamp) > 0)
+            break;
+        input_apply(input, event);
+        input->head++;
+    }
+    input->tick_pressed = input->pressed;
+    input->pressed = 0;
+}
+
+short input_active(const input_t* input, enum key key)
+{
+    return (input_keys(input) & (1u << key)) != 0;
+}
+
+// The keys that count for the current tick: the held ones and those tapped since the last tick.
+unsigned input_keys(const input_t* input)
+{
+    return input->held | input->tick_pressed;
+}
+
+static void input_apply(input_t* input, const input_event_t* event)
+{
+    if (event->pressed) {
+        input->held |= 1u << event->key;
+        input->pressed |= 1u << event->key;
+    } else {
+        input->held &= ~(1u << event->key);
+    }
+}
@@ -0,0 +1,60 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_INPUT_H
+#define BRICKS_INPUT_H
+
+// must be a power of two
+#define INPUT_RING_SIZE 64
+
+enum key {
+    LEFT, RIGHT, KEY_COUNT
+};
+
+typedef struct input_event {
+    unsigned timestamp;
+    enum key key;
+    short pressed;
+} input_event_t;
+
+// Key transitions are queued with their timestamp and applied by the simulation tick they fall
+// into, so a press and release within one frame still moves the paddle.
+typedef struct input {
+    input_event_t events[INPUT_RING_SIZE];
+    unsigned head, tail;
+    unsigned held;
+    unsigned pressed;
+    unsigned tick_pressed;
+} input_t;
+
+void input_reset(input_t *input);
+
+void input_push(input_t *input, enum key key, short pressed, unsigned timestamp);
+
+void input_update(input_t *input, unsigned timestamp);
+
+short input_active(const input_t *input, enum key key);
+
+unsigned input_keys(const input_t *input);
+
+#endif //BRICKS_INPUT_H
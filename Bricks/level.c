@@ -23,58 +23,115 @@
 // CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
 #include "level.h"
 #include "brick.h"
+#include "level_format.h"
 #include "types.h"
+#include <fcntl.h>
+#include <limits.h>
 #include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 const int BRICK_WIDTH = 40;
 const int BRICK_HEIGHT = 10;
+const int GRID_CELL_SIZE = 64;
+const int LEVEL_INITIAL_CAPACITY = 64;
+const size_t LEVEL_ARENA_BLOCK_SIZE = 64 * 1024;
+const size_t READ_CHUNK_SIZE = 1 << 20;
+
+static const color_t BRICK_PALETTE[BRICK_COLOR_COUNT] = {
+    { .r = 255, .g = 255, .b = 255, .a = 0 },
+    { .r = 155, .g = 0, .b = 0, .a = 0 },
+};
+
+// compiled levels store the int columns as int32
+typedef char level_int_is_32_bits[sizeof(int) == sizeof(int32_t) ? 1 : -1];
+
+// offsets of the grid arrays in a compiled level, from the start of the header
+typedef struct level_binary_layout {
+    size_t cell_start;
+    size_t cell_count;
+    size_t entries;
+    size_t size;
+} level_binary_layout_t;
+
+static level_t* level_alloc(void);
+static level_t* level_create_from_data(char* data, size_t size, int mapped, const char* name);
+static void level_index_bricks(level_t* level, int first);
+static void level_reserve(level_t* level, int capacity);
+static void level_carve(level_t* level, char* storage, int capacity);
+static int level_check_binary(const char* data, size_t size, level_binary_header_t* header, level_binary_layout_t* layout, const char* filename);
+static int level_check_checksum(const char* data, size_t size, const level_binary_header_t* header, const char* filename);
+static int level_check_colors(const unsigned char* colors, int count, const char* filename);
+static int level_check_grid(const level_binary_header_t* header, const int* cell_start, const int* cell_count, const int* entries, const char* filename);
+static int level_load_binary(level_t* level, char* data, size_t size, int mapped, const char* filename);
+static int level_parse_csv(level_t* level, const char* data, size_t size, const char* filename);
+static int parse_int(const char** cursor, const char* end, int* value);
+static int read_file(int fd, char** data, size_t* size);
+static FILE* open_output(const char* filename, char** temp_filename);
+static int close_output(FILE* file, char* temp_filename, const char* filename, int written);
+static int compare_descending(const void* a, const void* b);
+static void level_mark_dirty(level_t* level, int index);
+static unsigned position_hash(int x, int y);
 
 level_t* level_create(const char* level_filename)
 {
-    level_t* level = calloc(sizeof(level_t), 20);
-    level->bricks = calloc(sizeof(brick_t), 500);
-    FILE* file;
-    char* line = NULL;
-    size_t len = 0;
-    ssize_t read;
-    file = fopen(level_filename, "r");
-    if (file == NULL) {
+    int fd = open(level_filename, O_RDONLY);
+    if (fd < 0) {
         fprintf(stderr, "Failed to open file: %s\n", level_filename);
         return NULL;
     }
-    int brick_count = 0;
-    while ((read = getline(&line, &len, file)) != -1) {
-        int x, y, life_count;
-        int separator_count = 0;
-        int start = 0;
-        for (size_t i = 0; i < len; i++) {
-            if (line[i] == ';') {
-                char temp[i - start + 1];
-                strncpy(temp, line + start, i - start);
-                temp[i - start] = '\0';
-                switch (separator_count) {
-                case 0:
-                    x = atoi(temp);
-                    break;
-                case 1:
-                    y = atoi(temp);
-                    break;
-                case 2:
-                    life_count = atoi(temp);
-                    break;
-                }
-                start = i + 1;
-                separator_count++;
-            }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to read file: %s\n", level_filename);
+        close(fd);
+        return NULL;
+    }
+
+    // map regular files, anything else (pipes, special files) is read in large chunks
+    size_t size = (size_t)st.st_size;
+    char* data = NULL;
+    int mapped = FALSE;
+    if (S_ISREG(st.st_mode) && size > 0) {
+        // private and writable: a compiled level keeps using the mapping, copy on write
+        void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = mapping;
+            mapped = TRUE;
         }
-        level->bricks[brick_count] = brick_create(x, y, BRICK_WIDTH, BRICK_HEIGHT, life_count, COLOR_WHITE);
-        brick_count++;
-        level->brick_count++;
     }
-    fclose(file);
+    if (!mapped && !read_file(fd, &data, &size)) {
+        fprintf(stderr, "Failed to read file: %s\n", level_filename);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+
+    level_t* level = level_create_from_data(data, size, mapped, level_filename);
+    if (level == NULL || level->mapping != data) {
+        if (mapped) {
+            munmap(data, size);
+        } else {
+            free(data);
+        }
+    }
+    return level;
+}
+
+level_t* level_create_from_memory(const void* data, size_t size, const char* name)
+{
+    // only a mapped level file keeps pointing into the data, so it is never written to
+    return level_create_from_data((char*)data, size, FALSE, name);
+}
+
+level_t* level_create_empty(void)
+{
+    level_t* level = level_alloc();
+    level->grid = grid_create(level->arena, level->x, level->y, level->width, level->height, 0, GRID_CELL_SIZE);
     return level;
 }
 
@@ -82,14 +139,12 @@ level_t* level_create_random_level(int window_width, int window_height)
 {
     const int DEFAULT_X_DISTANCE = 10;
     const int DEFAULT_Y_DISTANCE = 10;
-    level_t* level = calloc(sizeof(level_t), 20);
-    level->bricks = calloc(sizeof(brick_t), 500);
+    level_t* level = level_alloc();
     // start with an offset to not have bricks directly at the window border
     int x = 10;
     int y = 50;
     for (size_t i = 0; i < 500; ++i) { // 500 bricks
-        level->bricks[i] = brick_create(x, y, BRICK_WIDTH, BRICK_HEIGHT, 2, COLOR_WHITE);
-        level->brick_count++;
+        level_add_brick(level, x, y, BRICK_WIDTH, BRICK_HEIGHT, 2, BRICK_COLOR_NORMAL);
         x += BRICK_WIDTH + DEFAULT_X_DISTANCE;
         if (x + BRICK_WIDTH > window_width) { // start a new line of bricks
             x = 10;
@@ -99,7 +154,25 @@ level_t* level_create_random_level(int window_width, int window_height)
             break;
         }
     }
-    return  level;
+    level->grid = grid_create(level->arena, level->x, level->y, level->width, level->height, level->brick_count, GRID_CELL_SIZE);
+    return level;
+}
+
+// Gives each game its own level to break, without loading the file again.
+level_t* level_copy(const level_t* source)
+{
+    level_t* level = level_alloc();
+    level_reserve(level, source->brick_count > 0 ? source->brick_count : LEVEL_INITIAL_CAPACITY);
+    size_t used = sizeof(int) * source->brick_count;
+    memcpy(level->x, source->x, used);
+    memcpy(level->y, source->y, used);
+    memcpy(level->width, source->width, used);
+    memcpy(level->height, source->height, used);
+    memcpy(level->life_count, source->life_count, used);
+    memcpy(level->color_index, source->color_index, source->brick_count);
+    level->brick_count = source->brick_count;
+    level->grid = grid_create(level->arena, level->x, level->y, level->width, level->height, level->brick_count, GRID_CELL_SIZE);
+    return level;
 }
 
 void level_destroy(level_t* level)
@@ -107,8 +180,737 @@ void level_destroy(level_t* level)
     if (level == NULL) {
         return;
     }
-    if (level->bricks != NULL) {
-        free(level->bricks);
+    if (level->mapping != NULL) {
+        munmap(level->mapping, level->mapping_size);
+    }
+    // a grid rebuilt by level_apply lives on the heap
+    grid_destroy(level->grid);
+    arena_destroy(level->arena);
+}
+
+int level_write_binary(const level_t* level, const char* filename)
+{
+    char* temp_filename;
+    FILE* file = open_output(filename, &temp_filename);
+    if (file == NULL) {
+        return FALSE;
+    }
+    return close_output(file, temp_filename, filename, level_write_binary_file(level, file));
+}
+
+int level_write_binary_file(const level_t* level, FILE* file)
+{
+    // the grid is stored as a fresh one, so a loaded level indexes its bricks like a parsed one
+    grid_t* grid = grid_create(NULL, level->x, level->y, level->width, level->height, level->brick_count, GRID_CELL_SIZE);
+    size_t cells = (size_t)grid->columns * grid->rows;
+    size_t ints = sizeof(int32_t) * level->brick_count;
+    static const char padding[4] = { 0 };
+    const void* parts[10] = { level->x, level->y, level->width, level->height, level->life_count, level->color_index,
+        padding, grid->cell_start, grid->cell_count, grid->entries };
+    const size_t sizes[10] = { ints, ints, ints, ints, ints, (size_t)level->brick_count, (4 - level->brick_count % 4) % 4,
+        sizeof(int32_t) * (cells + 1), sizeof(int32_t) * cells, sizeof(int32_t) * grid->cell_start[cells] };
+
+    level_binary_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_BINARY_MAGIC, 4);
+    header.version = LEVEL_BINARY_VERSION;
+    header.header_size = sizeof(header);
+    header.byte_order = LEVEL_BINARY_BYTE_ORDER;
+    header.brick_count = (uint32_t)level->brick_count;
+    header.grid_origin_x = grid->origin_x;
+    header.grid_origin_y = grid->origin_y;
+    header.grid_cell_size = grid->cell_size;
+    header.grid_columns = grid->columns;
+    header.grid_rows = grid->rows;
+    header.grid_entry_count = (uint32_t)grid->cell_start[cells];
+    header.checksum = level_binary_checksum(0, NULL, 0);
+    for (int i = 0; i < 10; i++) {
+        header.checksum = level_binary_checksum(header.checksum, parts[i], sizes[i]);
+    }
+
+    int written = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int i = 0; i < 10 && written; i++) {
+        written = sizes[i] == 0 || fwrite(parts[i], sizes[i], 1, file) == 1;
+    }
+    grid_destroy(grid);
+    return written;
+}
+
+int level_verify_binary(const void* data, size_t size, const char* name)
+{
+    level_binary_header_t header;
+    level_binary_layout_t layout;
+    if (size < 4 || memcmp(data, LEVEL_BINARY_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: not a compiled level\n", name);
+        return FALSE;
+    }
+    if (!level_check_binary(data, size, &header, &layout, name)) {
+        return FALSE;
+    }
+    const char* bytes = data;
+    int count = (int)header.brick_count;
+    return level_check_checksum(bytes, size, &header, name)
+        && level_check_colors((const unsigned char*)bytes + sizeof(header) + sizeof(int32_t) * 5 * count, count, name)
+        && level_check_grid(&header, (const int*)(bytes + layout.cell_start), (const int*)(bytes + layout.cell_count),
+            (const int*)(bytes + layout.entries), name);
+}
+
+int level_verify_file(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return FALSE;
+    }
+    char* data;
+    size_t size;
+    int loaded = read_file(fd, &data, &size);
+    close(fd);
+    if (!loaded) {
+        fprintf(stderr, "Failed to read file: %s\n", filename);
+        return FALSE;
+    }
+    int verified = level_verify_binary(data, size, filename);
+    free(data);
+    return verified;
+}
+
+int level_write_stream(const level_t* level, const char* filename, int chunk_height)
+{
+    level_stream_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_STREAM_MAGIC, 4);
+    header.version = LEVEL_STREAM_VERSION;
+    header.header_size = sizeof(header);
+    header.byte_order = LEVEL_BINARY_BYTE_ORDER;
+    header.chunk_height = (uint32_t)chunk_height;
+    header.brick_count = (uint64_t)level->brick_count;
+    int bottom = 0;
+    for (int i = 0; i < level->brick_count; i++) {
+        if (level->y[i] < 0) {
+            fprintf(stderr, "%s: brick %d lies above the level\n", filename, i);
+            return FALSE;
+        }
+        if (level->x[i] + level->width[i] > (int)header.world_width)
+            header.world_width = (uint32_t)(level->x[i] + level->width[i]);
+        if (level->y[i] + level->height[i] > bottom)
+            bottom = level->y[i] + level->height[i];
+        if (level->y[i] / chunk_height + 1 > (int)header.chunk_count)
+            header.chunk_count = (uint32_t)(level->y[i] / chunk_height + 1);
+    }
+    header.world_height = (uint32_t)bottom;
+
+    // bucket the bricks by chunk, keeping their order within a chunk
+    int* chunk_start = calloc(header.chunk_count + 1, sizeof(int));
+    int* order = malloc(sizeof(int) * (level->brick_count > 0 ? level->brick_count : 1));
+    for (int i = 0; i < level->brick_count; i++) {
+        chunk_start[level->y[i] / chunk_height + 1]++;
+    }
+    for (uint32_t c = 0; c < header.chunk_count; c++) {
+        chunk_start[c + 1] += chunk_start[c];
+    }
+    int* fill = malloc(sizeof(int) * (header.chunk_count > 0 ? header.chunk_count : 1));
+    memcpy(fill, chunk_start, sizeof(int) * header.chunk_count);
+    for (int i = 0; i < level->brick_count; i++) {
+        order[fill[level->y[i] / chunk_height]++] = i;
+    }
+    free(fill);
+
+    char* temp_filename;
+    FILE* file = open_output(filename, &temp_filename);
+    if (file == NULL) {
+        free(chunk_start);
+        free(order);
+        return FALSE;
+    }
+    // the chunk sizes are only known once they are written, so the entries are written again at the end
+    level_stream_entry_t* entries = calloc(header.chunk_count > 0 ? header.chunk_count : 1, sizeof(level_stream_entry_t));
+    int written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(entries, sizeof(level_stream_entry_t), header.chunk_count, file) == header.chunk_count;
+    for (uint32_t c = 0; c < header.chunk_count && written; c++) {
+        level_t* chunk = level_alloc();
+        for (int i = chunk_start[c]; i < chunk_start[c + 1]; i++) {
+            int b = order[i];
+            level_add_brick(chunk, level->x[b], level->y[b], level->width[b], level->height[b], level->life_count[b], level->color_index[b]);
+        }
+        long offset = ftell(file);
+        written = level_write_binary_file(chunk, file);
+        entries[c].offset = (uint64_t)offset;
+        entries[c].size = (uint32_t)(ftell(file) - offset);
+        entries[c].brick_count = (uint32_t)chunk->brick_count;
+        level_destroy(chunk);
+    }
+    written = written && fseek(file, (long)sizeof(header), SEEK_SET) == 0
+        && fwrite(entries, sizeof(level_stream_entry_t), header.chunk_count, file) == header.chunk_count;
+    free(entries);
+    free(chunk_start);
+    free(order);
+    return close_output(file, temp_filename, filename, written);
+}
+
+uint32_t level_binary_checksum(uint32_t hash, const void* data, size_t size)
+{
+    if (data == NULL) {
+        return 2166136261u;
+    }
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void level_add_brick(level_t* level, int x, int y, int width, int height, int life_count, enum brick_color color)
+{
+    if (level->brick_count == level->capacity) {
+        level_reserve(level, level->capacity == 0 ? LEVEL_INITIAL_CAPACITY : level->capacity * 2);
+    }
+    int i = level->brick_count++;
+    level->revision++;
+    level->x[i] = x;
+    level->y[i] = y;
+    level->width[i] = width;
+    level->height[i] = height;
+    level->life_count[i] = life_count;
+    level->color_index[i] = (unsigned char)color;
+    level_mark_dirty(level, i);
+}
+
+brick_t level_brick(const level_t* level, int index)
+{
+    brick_t brick = {
+        .x = level->x[index],
+        .y = level->y[index],
+        .width = level->width[index],
+        .height = level->height[index],
+        .life_count = level->life_count[index],
+        .color = BRICK_PALETTE[level->color_index[index]],
+    };
+    return brick;
+}
+
+color_t level_brick_color(const level_t* level, int index)
+{
+    return BRICK_PALETTE[level->color_index[index]];
+}
+
+void level_hit_brick(level_t* level, int index)
+{
+    if (level->hit_count < LEVEL_MAX_HITS) {
+        level_hit_t* hit = &level->hits[level->hit_count++];
+        hit->x = level->x[index];
+        hit->y = level->y[index];
+        hit->width = level->width[index];
+        hit->height = level->height[index];
+        hit->color = level_brick_color(level, index);
+        hit->destroyed = level->life_count[index] <= 1;
+    }
+    level->life_count[index]--;
+    level->revision++;
+    if (level->color_index[index] != BRICK_COLOR_WEAK) {
+        level->color_index[index] = BRICK_COLOR_WEAK;
+        level_mark_dirty(level, index);
+    }
+}
+
+void level_remove_brick(level_t* level, int index)
+{
+    int last = level->brick_count - 1;
+    level->revision++;
+    level_mark_dirty(level, index);
+    grid_remove(level->grid, index, level->x[index], level->y[index], level->width[index], level->height[index]);
+    if (index != last) {
+        grid_rename(level->grid, last, index, level->x[last], level->y[last], level->width[last], level->height[last]);
+        level->x[index] = level->x[last];
+        level->y[index] = level->y[last];
+        level->width[index] = level->width[last];
+        level->height[index] = level->height[last];
+        level->life_count[index] = level->life_count[last];
+        level->color_index[index] = level->color_index[last];
+    }
+    level->brick_count--;
+}
+
+void level_remove_bricks(level_t* level, int* indices, int count)
+{
+    // going from the highest index down, the brick swapped into a freed slot is never one still to be removed
+    qsort(indices, count, sizeof(int), compare_descending);
+    for (int i = 0; i < count; i++) {
+        level_remove_brick(level, indices[i]);
+    }
+}
+
+void level_clear_dirty(level_t* level)
+{
+    level->dirty_count = 0;
+    level->dirty_all = FALSE;
+}
+
+void level_clear_hits(level_t* level)
+{
+    level->hit_count = 0;
+}
+
+level_diff_t level_apply(level_t* level, const level_t* target)
+{
+    level_diff_t diff = { 0, 0, 0 };
+    level->revision++;
+    // open addressing over the target's bricks, keyed by position
+    unsigned table_size = 16;
+    while (table_size < (unsigned)target->brick_count * 2) {
+        table_size *= 2;
+    }
+    int* table = malloc(sizeof(int) * table_size);
+    memset(table, -1, sizeof(int) * table_size);
+    for (int i = 0; i < target->brick_count; i++) {
+        unsigned slot = position_hash(target->x[i], target->y[i]) & (table_size - 1);
+        while (table[slot] >= 0) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        table[slot] = i;
+    }
+    unsigned char* matched = calloc(target->brick_count > 0 ? target->brick_count : 1, 1);
+    int* removed = malloc(sizeof(int) * (level->brick_count > 0 ? level->brick_count : 1));
+
+    for (int i = 0; i < level->brick_count; i++) {
+        // of several bricks stacked on one position, an identical one is preferred
+        int match = -1;
+        unsigned slot = position_hash(level->x[i], level->y[i]) & (table_size - 1);
+        for (; table[slot] >= 0; slot = (slot + 1) & (table_size - 1)) {
+            int j = table[slot];
+            if (matched[j] || target->x[j] != level->x[i] || target->y[j] != level->y[i])
+                continue;
+            if (match < 0)
+                match = j;
+            if (target->width[j] == level->width[i] && target->height[j] == level->height[i]
+                && target->life_count[j] == level->life_count[i] && target->color_index[j] == level->color_index[i]) {
+                match = j;
+                break;
+            }
+        }
+        // a resized brick goes through the grid again, so it is replaced instead of changed
+        if (match < 0 || target->width[match] != level->width[i] || target->height[match] != level->height[i]) {
+            removed[diff.removed++] = i;
+            continue;
+        }
+        matched[match] = TRUE;
+        if (target->life_count[match] != level->life_count[i] || target->color_index[match] != level->color_index[i]) {
+            level->life_count[i] = target->life_count[match];
+            if (target->color_index[match] != level->color_index[i]) {
+                level->color_index[i] = target->color_index[match];
+                level_mark_dirty(level, i);
+            }
+            diff.changed++;
+        }
+    }
+    level_remove_bricks(level, removed, diff.removed);
+
+    int first_added = level->brick_count;
+    for (int j = 0; j < target->brick_count; j++) {
+        if (matched[j])
+            continue;
+        level_add_brick(level, target->x[j], target->y[j], target->width[j], target->height[j], target->life_count[j], target->color_index[j]);
+        diff.added++;
+    }
+    level_index_bricks(level, first_added);
+    free(removed);
+    free(matched);
+    free(table);
+    return diff;
+}
+
+void level_append(level_t* level, const level_t* bricks, int dy)
+{
+    int first = level->brick_count;
+    for (int i = 0; i < bricks->brick_count; i++) {
+        level_add_brick(level, bricks->x[i], bricks->y[i] + dy, bricks->width[i], bricks->height[i], bricks->life_count[i], bricks->color_index[i]);
+    }
+    level_index_bricks(level, first);
+}
+
+int level_remove_band(level_t* level, int top, int bottom)
+{
+    int* removed = malloc(sizeof(int) * (level->brick_count > 0 ? level->brick_count : 1));
+    int count = 0;
+    for (int i = 0; i < level->brick_count; i++) {
+        if (level->y[i] >= top && level->y[i] < bottom) {
+            removed[count++] = i;
+        }
+    }
+    level_remove_bricks(level, removed, count);
+    free(removed);
+    return count;
+}
+
+void level_translate(level_t* level, int dy)
+{
+    for (int i = 0; i < level->brick_count; i++) {
+        level->y[i] += dy;
+    }
+    grid_translate(level->grid, 0, dy);
+    level->revision++;
+    level->dirty_all = TRUE;
+}
+
+static level_t* level_create_from_data(char* data, size_t size, int mapped, const char* name)
+{
+    level_t* level = level_alloc();
+    int loaded;
+    if (size >= 4 && memcmp(data, LEVEL_BINARY_MAGIC, 4) == 0) {
+        // a compiled level comes with its grid
+        loaded = level_load_binary(level, data, size, mapped, name);
+    } else {
+        loaded = level_parse_csv(level, data, size, name);
+        if (loaded)
+            level->grid = grid_create(level->arena, level->x, level->y, level->width, level->height, level->brick_count, GRID_CELL_SIZE);
+    }
+    if (!loaded) {
+        level_destroy(level);
+        return NULL;
+    }
+    return level;
+}
+
+// Puts the bricks from first on into the grid, in the room left by removed ones if there is
+// enough of it. Otherwise the grid is rebuilt on the heap.
+static void level_index_bricks(level_t* level, int first)
+{
+    for (int i = first; i < level->brick_count; i++) {
+        if (!grid_insert(level->grid, i, level->x[i], level->y[i], level->width[i], level->height[i])) {
+            grid_destroy(level->grid);
+            level->grid = grid_create(NULL, level->x, level->y, level->width, level->height, level->brick_count, GRID_CELL_SIZE);
+            return;
+        }
+    }
+}
+
+static level_t* level_alloc(void)
+{
+    arena_t* arena = arena_create(LEVEL_ARENA_BLOCK_SIZE);
+    level_t* level = arena_alloc_zeroed(arena, sizeof(level_t));
+    level->arena = arena;
+    level->dirty_all = TRUE;
+    return level;
+}
+
+// Outgrown storage stays in the arena until the level goes away; with doubling that is never
+// more than the current storage.
+static void level_reserve(level_t* level, int capacity)
+{
+    int* old_x = level->x;
+    int* old_y = level->y;
+    int* old_width = level->width;
+    int* old_height = level->height;
+    int* old_life_count = level->life_count;
+    unsigned char* old_color_index = level->color_index;
+
+    char* storage = arena_alloc(level->arena, sizeof(int) * capacity * 5 + capacity);
+    level_carve(level, storage, capacity);
+    if (level->brick_count > 0) {
+        size_t used = sizeof(int) * level->brick_count;
+        memcpy(level->x, old_x, used);
+        memcpy(level->y, old_y, used);
+        memcpy(level->width, old_width, used);
+        memcpy(level->height, old_height, used);
+        memcpy(level->life_count, old_life_count, used);
+        memcpy(level->color_index, old_color_index, level->brick_count);
+    }
+    // a level that outgrows its compiled file moves to the heap for good
+    if (level->mapping != NULL) {
+        grid_own_cells(level->grid);
+        munmap(level->mapping, level->mapping_size);
+        level->mapping = NULL;
+        level->mapping_size = 0;
+    }
+    level->storage = storage;
+}
+
+// Points the brick arrays into a block laid out as five int columns followed by the color column.
+static void level_carve(level_t* level, char* storage, int capacity)
+{
+    size_t ints = sizeof(int) * capacity;
+    level->x = (int*)storage;
+    level->y = (int*)(storage + ints);
+    level->width = (int*)(storage + ints * 2);
+    level->height = (int*)(storage + ints * 3);
+    level->life_count = (int*)(storage + ints * 4);
+    level->color_index = (unsigned char*)(storage + ints * 5);
+    level->capacity = capacity;
+}
+
+// Checks the header against the file size, the contents are checked by the functions below.
+static int level_check_binary(const char* data, size_t size, level_binary_header_t* header, level_binary_layout_t* layout, const char* filename)
+{
+    if (size < sizeof(*header)) {
+        fprintf(stderr, "%s: truncated level header\n", filename);
+        return FALSE;
+    }
+    memcpy(header, data, sizeof(*header));
+    if (header->version != LEVEL_BINARY_VERSION || header->header_size != sizeof(*header)) {
+        fprintf(stderr, "%s: unsupported level format version %d\n", filename, header->version);
+        return FALSE;
+    }
+    if (header->byte_order != LEVEL_BINARY_BYTE_ORDER) {
+        fprintf(stderr, "%s: level was compiled for a different byte order\n", filename);
+        return FALSE;
+    }
+    if (header->brick_count > INT_MAX / LEVEL_BINARY_BYTES_PER_BRICK || header->grid_cell_size <= 0
+        || header->grid_columns < 0 || header->grid_rows < 0 || (int64_t)header->grid_columns * header->grid_rows >= INT_MAX
+        || header->grid_entry_count > INT_MAX) {
+        fprintf(stderr, "%s: corrupt level header\n", filename);
+        return FALSE;
+    }
+    size_t columns = (size_t)header->brick_count * LEVEL_BINARY_BYTES_PER_BRICK;
+    size_t cells = (size_t)header->grid_columns * header->grid_rows;
+    layout->cell_start = sizeof(*header) + (columns + 3) / 4 * 4;
+    layout->cell_count = layout->cell_start + sizeof(int32_t) * (cells + 1);
+    layout->entries = layout->cell_count + sizeof(int32_t) * cells;
+    layout->size = layout->entries + sizeof(int32_t) * header->grid_entry_count;
+    if (size != layout->size) {
+        fprintf(stderr, "%s: file size doesn't match %u bricks\n", filename, header->brick_count);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int level_check_checksum(const char* data, size_t size, const level_binary_header_t* header, const char* filename)
+{
+    uint32_t checksum = level_binary_checksum(level_binary_checksum(0, NULL, 0), data + sizeof(*header), size - sizeof(*header));
+    if (checksum != header->checksum) {
+        fprintf(stderr, "%s: checksum mismatch\n", filename);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int level_check_colors(const unsigned char* colors, int count, const char* filename)
+{
+    for (int i = 0; i < count; i++) {
+        if (colors[i] >= BRICK_COLOR_COUNT) {
+            fprintf(stderr, "%s: brick %d has an unknown color %d\n", filename, i, colors[i]);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// Every slice has to lie within the entries and hold known bricks only, the grid writes through them.
+static int level_check_grid(const level_binary_header_t* header, const int* cell_start, const int* cell_count, const int* entries, const char* filename)
+{
+    size_t cells = (size_t)header->grid_columns * header->grid_rows;
+    int count = (int)header->brick_count;
+    if (cell_start[0] != 0 || cell_start[cells] != (int)header->grid_entry_count) {
+        fprintf(stderr, "%s: grid doesn't match its %u entries\n", filename, header->grid_entry_count);
+        return FALSE;
+    }
+    for (size_t cell = 0; cell < cells; cell++) {
+        if (cell_start[cell + 1] < cell_start[cell] || cell_count[cell] < 0 || cell_count[cell] > cell_start[cell + 1] - cell_start[cell]) {
+            fprintf(stderr, "%s: grid cell %zu is out of bounds\n", filename, cell);
+            return FALSE;
+        }
+        const int* slice = entries + cell_start[cell];
+        for (int i = 0; i < cell_count[cell]; i++) {
+            if (slice[i] < 0 || slice[i] >= count) {
+                fprintf(stderr, "%s: grid cell %zu holds an unknown brick\n", filename, cell);
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+// A mapped file only gets the checks that keep the level within its arrays; data that is copied anyway
+// is checked in full, as it may come from a replay or a pack.
+static int level_load_binary(level_t* level, char* data, size_t size, int mapped, const char* filename)
+{
+    level_binary_header_t header;
+    level_binary_layout_t layout;
+    if (!level_check_binary(data, size, &header, &layout, filename)) {
+        return FALSE;
+    }
+    if (!mapped && !level_check_checksum(data, size, &header, filename)) {
+        return FALSE;
+    }
+    int count = (int)header.brick_count;
+    char* cells = data + layout.cell_start;
+    if (!mapped) {
+        if (count > 0) {
+            level_reserve(level, count);
+            memcpy(level->storage, data + sizeof(header), (size_t)count * LEVEL_BINARY_BYTES_PER_BRICK);
+        }
+        cells = memcpy(arena_alloc(level->arena, size - layout.cell_start), cells, size - layout.cell_start);
+    }
+    const unsigned char* colors = mapped ? (unsigned char*)data + sizeof(header) + sizeof(int32_t) * 5 * count : level->color_index;
+    int* cell_start = (int*)cells;
+    int* cell_count = (int*)(cells + (layout.cell_count - layout.cell_start));
+    int* entries = (int*)(cells + (layout.entries - layout.cell_start));
+    if (!level_check_colors(colors, count, filename) || !level_check_grid(&header, cell_start, cell_count, entries, filename)) {
+        return FALSE;
+    }
+    // the level only takes the mapping over once it passed, level_create unmaps it otherwise
+    if (mapped) {
+        level_carve(level, data + sizeof(header), count);
+        level->mapping = data;
+        level->mapping_size = size;
+    }
+    level->brick_count = count;
+    level->grid = grid_wrap(level->arena, count, header.grid_origin_x, header.grid_origin_y, header.grid_cell_size,
+        header.grid_columns, header.grid_rows, cell_start, cell_count, entries);
+    return TRUE;
+}
+
+// Parses lines of the form "x;y;life_count;" straight out of the buffer. The trailing separator
+// is optional, so are blank lines and '\r' before the line break.
+static int level_parse_csv(level_t* level, const char* data, size_t size, const char* filename)
+{
+    const char* cursor = data;
+    const char* end = data + size;
+    int line = 1;
+    while (cursor < end) {
+        if (*cursor == '\n') {
+            line++;
+            cursor++;
+            continue;
+        }
+        if (*cursor == '\r') {
+            cursor++;
+            continue;
+        }
+
+        int values[3];
+        for (int field = 0; field < 3; field++) {
+            if (!parse_int(&cursor, end, &values[field])) {
+                fprintf(stderr, "%s:%d: expected a number in field %d\n", filename, line, field + 1);
+                return FALSE;
+            }
+            if (cursor < end && *cursor == ';') {
+                cursor++;
+            } else if (field < 2) {
+                fprintf(stderr, "%s:%d: expected ';' after field %d\n", filename, line, field + 1);
+                return FALSE;
+            }
+        }
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+            cursor++;
+        }
+        if (cursor < end && *cursor != '\n') {
+            fprintf(stderr, "%s:%d: unexpected '%c' after the last field\n", filename, line, *cursor);
+            return FALSE;
+        }
+        level_add_brick(level, values[0], values[1], BRICK_WIDTH, BRICK_HEIGHT, values[2], BRICK_COLOR_NORMAL);
+    }
+    return TRUE;
+}
+
+static int parse_int(const char** cursor, const char* end, int* value)
+{
+    const char* c = *cursor;
+    while (c < end && (*c == ' ' || *c == '\t')) {
+        c++;
+    }
+    int negative = FALSE;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = *c == '-';
+        c++;
+    }
+    if (c == end || *c < '0' || *c > '9') {
+        return FALSE;
+    }
+    long long result = 0;
+    while (c < end && *c >= '0' && *c <= '9') {
+        result = result * 10 + (*c - '0');
+        if (result > (long long)INT_MAX + 1) {
+            return FALSE;
+        }
+        c++;
+    }
+    if (negative) {
+        result = -result;
+    }
+    if (result > INT_MAX) {
+        return FALSE;
+    }
+    while (c < end && (*c == ' ' || *c == '\t')) {
+        c++;
+    }
+    *value = (int)result;
+    *cursor = c;
+    return TRUE;
+}
+
+static int read_file(int fd, char** data, size_t* size)
+{
+    size_t capacity = READ_CHUNK_SIZE;
+    size_t used = 0;
+    char* buffer = malloc(capacity);
+    for (;;) {
+        if (capacity - used < READ_CHUNK_SIZE) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+        }
+        ssize_t count = read(fd, buffer + used, capacity - used);
+        if (count < 0) {
+            free(buffer);
+            return FALSE;
+        }
+        if (count == 0) {
+            break;
+        }
+        used += (size_t)count;
+    }
+    *data = buffer;
+    *size = used;
+    return TRUE;
+}
+
+// Output goes to a file next to the target that is renamed over it once complete. A game that has
+// the old file mapped or open keeps reading the old contents instead of a truncated file.
+static FILE* open_output(const char* filename, char** temp_filename)
+{
+    *temp_filename = malloc(strlen(filename) + 5);
+    sprintf(*temp_filename, "%s.tmp", filename);
+    FILE* file = fopen(*temp_filename, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", *temp_filename);
+        free(*temp_filename);
+    }
+    return file;
+}
+
+static int close_output(FILE* file, char* temp_filename, const char* filename, int written)
+{
+    written = fclose(file) == 0 && written && rename(temp_filename, filename) == 0;
+    if (!written) {
+        fprintf(stderr, "Failed to write file: %s\n", filename);
+        remove(temp_filename);
+    }
+    free(temp_filename);
+    return written;
+}
+
+static unsigned position_hash(int x, int y)
+{
+    return ((unsigned)x * 73856093u) ^ ((unsigned)y * 19349663u);
+}
+
+static int compare_descending(const void* a, const void* b)
+{
+    int ia = *(const int*)a;
+    int ib = *(const int*)b;
+    return (ib > ia) - (ib < ia);
+}
+
+static void level_mark_dirty(level_t* level, int index)
+{
+    if (level->dirty_all)
+        return;
+    if (level->dirty_count == LEVEL_MAX_DIRTY_RECTS) {
+        level->dirty_all = TRUE;
+        return;
     }
-    free(level);
+    level_rect_t* rect = &level->dirty[level->dirty_count++];
+    rect->x = level->x[index];
+    rect->y = level->y[index];
+    rect->width = level->width[index];
+    rect->height = level->height[index];
 }
@@ -24,16 +24,91 @@
 #ifndef BRICKS_LEVEL_H
 #define BRICKS_LEVEL_H
 
+#include "arena.h"
 #include "brick.h"
+#include "grid.h"
+#include <stddef.h>
+#include <stdio.h>
 
+// more changes than this between two redraws and the whole level counts as changed
+#define LEVEL_MAX_DIRTY_RECTS 64
+#define LEVEL_MAX_HITS 256
 
+typedef struct level_rect {
+    int x, y;
+    int width, height;
+} level_rect_t;
+
+typedef struct level_hit {
+    int x, y;
+    int width, height;
+    color_t color; // before the hit
+    short destroyed;
+} level_hit_t;
+
+// what level_apply changed
+typedef struct level_diff {
+    int added, removed, changed;
+} level_diff_t;
+
+// Bricks are stored as parallel arrays carved out of a single allocation. Live bricks are always
+// packed into [0, brick_count): removing a brick moves the last one into its slot.
+// Everything a level allocates, the level itself included, comes from its arena.
 typedef struct level {
-    brick_t **bricks;
+    arena_t *arena;
+    int *x, *y;
+    int *width, *height;
+    int *life_count;
+    unsigned char *color_index;
     int brick_count;
+    int capacity;
+    void *storage;
+    void *mapping; // set when the arrays live in a mapped compiled level file
+    size_t mapping_size;
+    grid_t *grid;
+    // areas whose look changed since the last level_clear_dirty()
+    level_rect_t dirty[LEVEL_MAX_DIRTY_RECTS];
+    int dirty_count;
+    short dirty_all;
+    // bricks hit since the last level_clear_hits(), the ones past the limit aren't kept
+    level_hit_t hits[LEVEL_MAX_HITS];
+    int hit_count;
+    unsigned long revision; // goes up with every change to the bricks
 } level_t;
 
+// Loads either a compiled level (see level_format.h) or a CSV level, depending on the file's contents.
 level_t *level_create(const char *level_filename);
+// Like level_create, for a level file that is already in memory.
+level_t *level_create_from_memory(const void *data, size_t size, const char *name);
+level_t *level_create_empty(void);
 level_t *level_create_random_level(int window_width, int window_height);
+level_t *level_copy(const level_t *level);
 void level_destroy(level_t *level);
+int level_write_binary(const level_t *level, const char *filename);
+int level_write_binary_file(const level_t *level, FILE *file);
+// Checks all of a compiled level: its checksum, colors and grid. Loading a mapped file skips the checksum.
+int level_verify_binary(const void *data, size_t size, const char *name);
+int level_verify_file(const char *filename);
+// Writes the level as a streamed level, see level_format.h. Bricks must not lie above y = 0.
+int level_write_stream(const level_t *level, const char *filename, int chunk_height);
+
+void level_add_brick(level_t *level, int x, int y, int width, int height, int life_count, enum brick_color color);
+brick_t level_brick(const level_t *level, int index);
+color_t level_brick_color(const level_t *level, int index);
+// Takes one life from the brick and marks it as damaged.
+void level_hit_brick(level_t *level, int index);
+void level_remove_brick(level_t *level, int index);
+// Removes several bricks at once; the indices are reordered in place.
+void level_remove_bricks(level_t *level, int *indices, int count);
+void level_clear_dirty(level_t *level);
+void level_clear_hits(level_t *level);
+// Turns the level into the target by adding, removing and changing only the bricks that differ.
+// Bricks are matched by position; the grid and the dirty rects are updated as the bricks change.
+level_diff_t level_apply(level_t *level, const level_t *target);
+// Adds all bricks of another level, moved down by dy.
+void level_append(level_t *level, const level_t *bricks, int dy);
+// Removes the bricks whose top edge lies in [top, bottom) and returns how many there were.
+int level_remove_band(level_t *level, int top, int bottom);
+void level_translate(level_t *level, int dy);
 
 #endif
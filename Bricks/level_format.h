@@ -0,0 +1,81 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_LEVEL_FORMAT_H
+#define BRICKS_LEVEL_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Compiled levels: a fixed header followed by the brick columns in the exact layout level_t uses in
+// memory (x, y, width, height and life count as int32, then one color index byte per brick), so a
+// mapped file can back a level without any parsing. The columns are padded to four bytes and followed
+// by the level's grid as grid_create builds it: cell_start (one more than the cells), cell_count and
+// the entries, all int32. The checksum is FNV-1a over everything after the header. Loading checks
+// the color indices and the grid slices, and the checksum of data it copies; `bricks_levelc --verify`
+// checks the checksum of a file that is mapped as well.
+#define LEVEL_BINARY_MAGIC "BRKL"
+#define LEVEL_BINARY_VERSION 2
+#define LEVEL_BINARY_BYTE_ORDER 0x01020304u
+#define LEVEL_BINARY_BYTES_PER_BRICK (5 * sizeof(int32_t) + 1)
+
+typedef struct level_binary_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t byte_order;
+    uint32_t brick_count;
+    uint32_t checksum;
+    int32_t grid_origin_x, grid_origin_y;
+    int32_t grid_cell_size;
+    int32_t grid_columns, grid_rows;
+    uint32_t grid_entry_count;
+    uint32_t reserved;
+} level_binary_header_t;
+
+// Streamed levels: the bricks are cut into horizontal bands of chunk_height pixels by their y. The
+// header is followed by one entry per chunk, then by the chunks, each of them a complete compiled level.
+#define LEVEL_STREAM_MAGIC "BRKS"
+#define LEVEL_STREAM_VERSION 2
+
+typedef struct level_stream_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t byte_order;
+    uint32_t chunk_height;
+    uint32_t chunk_count;
+    uint32_t world_width, world_height;
+    uint32_t reserved;
+    uint64_t brick_count;
+} level_stream_header_t;
+
+typedef struct level_stream_entry {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t brick_count;
+} level_stream_entry_t;
+
+uint32_t level_binary_checksum(uint32_t hash, const void *data, size_t size);
+
+#endif //BRICKS_LEVEL_FORMAT_H
@@ -0,0 +1,309 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "level_stream.h"
+#include "types.h"
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int level_stream_read_header(int fd, level_stream_header_t* header, const char* filename);
+static void* level_stream_load(void* data);
+static level_t* level_stream_read_chunk(level_stream_t* stream, int chunk);
+static void level_stream_drop_ready(level_stream_t* stream, int index);
+static int chunk_list_find(const int* list, int count, int chunk);
+static void chunk_list_remove(int* list, int* count, int index);
+
+int level_stream_probe(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return FALSE;
+    char magic[4];
+    int is_stream = read(fd, magic, 4) == 4 && memcmp(magic, LEVEL_STREAM_MAGIC, 4) == 0;
+    close(fd);
+    return is_stream;
+}
+
+level_stream_t* level_stream_open(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return NULL;
+    }
+    level_stream_header_t header;
+    if (!level_stream_read_header(fd, &header, filename)) {
+        close(fd);
+        return NULL;
+    }
+
+    level_stream_t* stream = calloc(1, sizeof(level_stream_t));
+    stream->fd = fd;
+    stream->filename = strdup(filename);
+    stream->header = header;
+    stream->want_first = 0;
+    stream->want_last = -1;
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->wake, NULL);
+    pthread_cond_init(&stream->loaded, NULL);
+    pthread_create(&stream->thread, NULL, level_stream_load, stream);
+    return stream;
+}
+
+int level_stream_verify(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return FALSE;
+    }
+    level_stream_header_t header;
+    int verified = level_stream_read_header(fd, &header, filename);
+    for (uint32_t c = 0; verified && c < header.chunk_count; c++) {
+        level_stream_entry_t entry;
+        char* data = NULL;
+        verified = pread(fd, &entry, sizeof(entry), (off_t)(sizeof(header) + sizeof(entry) * c)) == sizeof(entry);
+        if (verified) {
+            data = malloc(entry.size > 0 ? entry.size : 1);
+            verified = pread(fd, data, entry.size, (off_t)entry.offset) == (ssize_t)entry.size;
+        }
+        if (!verified) {
+            fprintf(stderr, "%s: can't read chunk %u\n", filename, c);
+        } else {
+            char name[512];
+            snprintf(name, sizeof(name), "%s chunk %u", filename, c);
+            verified = level_verify_binary(data, entry.size, name);
+        }
+        free(data);
+    }
+    close(fd);
+    return verified;
+}
+
+void level_stream_close(level_stream_t* stream)
+{
+    if (stream == NULL)
+        return;
+    pthread_mutex_lock(&stream->lock);
+    stream->stop = TRUE;
+    pthread_cond_signal(&stream->wake);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+
+    for (int i = 0; i < stream->ready_count; i++) {
+        level_destroy(stream->ready[i]);
+    }
+    pthread_cond_destroy(&stream->loaded);
+    pthread_cond_destroy(&stream->wake);
+    pthread_mutex_destroy(&stream->lock);
+    close(stream->fd);
+    free(stream->filename);
+    free(stream);
+}
+
+int level_stream_start_y(const level_stream_t* stream, int view_height)
+{
+    int start = (int)stream->header.world_height - view_height / 2;
+    return start > 0 ? start : 0;
+}
+
+int level_stream_update(level_stream_t* stream, level_t* level, int view_y, int view_height)
+{
+    int chunk_height = (int)stream->header.chunk_height;
+    int last_chunk = (int)stream->header.chunk_count - 1;
+    int world_y = stream->origin_y + view_y;
+    int view_first = world_y > 0 ? world_y / chunk_height : 0;
+    int first = view_first - LEVEL_STREAM_AHEAD;
+    int last = (world_y + view_height - 1) / chunk_height;
+    if (first < 0)
+        first = 0;
+    if (last > last_chunk)
+        last = last_chunk;
+    if (last - first + 1 > LEVEL_STREAM_MAX_CHUNKS)
+        first = last - LEVEL_STREAM_MAX_CHUNKS + 1;
+
+    // drop the chunks the view left behind, scrolling back up doesn't bring them back
+    for (int i = 0; i < stream->resident_count;) {
+        int chunk = stream->resident[i];
+        if (chunk < first || chunk > last) {
+            level_remove_band(level, chunk * chunk_height - stream->origin_y, (chunk + 1) * chunk_height - stream->origin_y);
+            chunk_list_remove(stream->resident, &stream->resident_count, i);
+        } else {
+            i++;
+        }
+    }
+    for (int i = 0; i < stream->requested_count;) {
+        int chunk = stream->requested[i];
+        if (chunk < first || chunk > last) {
+            chunk_list_remove(stream->requested, &stream->requested_count, i);
+        } else {
+            i++;
+        }
+    }
+
+    // the origin sits at the top of the first chunk the view needs
+    int shift = 0;
+    if (first * chunk_height != stream->origin_y) {
+        shift = stream->origin_y - first * chunk_height;
+        stream->origin_y = first * chunk_height;
+        level_translate(level, shift);
+    }
+
+    pthread_mutex_lock(&stream->lock);
+    stream->want_first = first;
+    stream->want_last = last;
+    // the chunks in view come first, then the ones ahead of it
+    for (int chunk = last; chunk >= first; chunk--) {
+        if (chunk_list_find(stream->resident, stream->resident_count, chunk) < 0
+            && chunk_list_find(stream->requested, stream->requested_count, chunk) < 0) {
+            stream->requested[stream->requested_count++] = chunk;
+            stream->queue[stream->queue_count++] = chunk;
+        }
+    }
+    pthread_cond_signal(&stream->wake);
+    // The chunks ahead load in the background, but only chunks in view are merged, and the game waits
+    // for them. What the game plays against so never depends on how fast the loader was.
+    for (;;) {
+        for (int i = 0; i < stream->ready_count;) {
+            if (chunk_list_find(stream->requested, stream->requested_count, stream->ready_chunk[i]) < 0) {
+                level_stream_drop_ready(stream, i);
+            } else {
+                i++;
+            }
+        }
+        int missing = FALSE;
+        for (int chunk = view_first; chunk <= last && !missing; chunk++) {
+            missing = chunk_list_find(stream->resident, stream->resident_count, chunk) < 0
+                && chunk_list_find(stream->ready_chunk, stream->ready_count, chunk) < 0;
+        }
+        if (!missing)
+            break;
+        pthread_cond_wait(&stream->loaded, &stream->lock);
+    }
+    // in chunk order, so the bricks also end up in the same order in the level
+    for (int chunk = last; chunk >= view_first; chunk--) {
+        int ready = chunk_list_find(stream->ready_chunk, stream->ready_count, chunk);
+        if (ready < 0)
+            continue;
+        level_append(level, stream->ready[ready], -stream->origin_y);
+        chunk_list_remove(stream->requested, &stream->requested_count, chunk_list_find(stream->requested, stream->requested_count, chunk));
+        stream->resident[stream->resident_count++] = chunk;
+        level_stream_drop_ready(stream, ready);
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return shift;
+}
+
+// Keeps the ready chunks in the order they loaded in.
+static void level_stream_drop_ready(level_stream_t* stream, int index)
+{
+    level_destroy(stream->ready[index]);
+    for (int i = index + 1; i < stream->ready_count; i++) {
+        stream->ready[i - 1] = stream->ready[i];
+        stream->ready_chunk[i - 1] = stream->ready_chunk[i];
+    }
+    stream->ready_count--;
+}
+
+static int level_stream_read_header(int fd, level_stream_header_t* header, const char* filename)
+{
+    if (pread(fd, header, sizeof(*header), 0) != sizeof(*header) || memcmp(header->magic, LEVEL_STREAM_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: not a streamed level\n", filename);
+        return FALSE;
+    }
+    if (header->version != LEVEL_STREAM_VERSION || header->header_size != sizeof(*header)
+        || header->byte_order != LEVEL_BINARY_BYTE_ORDER || header->chunk_height == 0) {
+        fprintf(stderr, "%s: unsupported streamed level\n", filename);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void* level_stream_load(void* data)
+{
+    level_stream_t* stream = data;
+    pthread_mutex_lock(&stream->lock);
+    for (;;) {
+        while (!stream->stop && (stream->queue_count == 0 || stream->ready_count == LEVEL_STREAM_MAX_CHUNKS)) {
+            pthread_cond_wait(&stream->wake, &stream->lock);
+        }
+        if (stream->stop)
+            break;
+        int chunk = stream->queue[0];
+        chunk_list_remove(stream->queue, &stream->queue_count, 0);
+        // the view may have moved on while the chunk was queued
+        if (chunk < stream->want_first || chunk > stream->want_last)
+            continue;
+
+        pthread_mutex_unlock(&stream->lock);
+        level_t* level = level_stream_read_chunk(stream, chunk);
+        pthread_mutex_lock(&stream->lock);
+        if (level == NULL) {
+            // an unreadable chunk stays empty rather than blocking the game
+            level = level_create_empty();
+        }
+        stream->ready[stream->ready_count] = level;
+        stream->ready_chunk[stream->ready_count] = chunk;
+        stream->ready_count++;
+        pthread_cond_signal(&stream->loaded);
+    }
+    pthread_mutex_unlock(&stream->lock);
+    return NULL;
+}
+
+static level_t* level_stream_read_chunk(level_stream_t* stream, int chunk)
+{
+    level_stream_entry_t entry;
+    off_t entry_offset = (off_t)sizeof(level_stream_header_t) + (off_t)chunk * (off_t)sizeof(entry);
+    if (pread(stream->fd, &entry, sizeof(entry), entry_offset) != sizeof(entry)) {
+        fprintf(stderr, "%s: can't read the entry of chunk %d\n", stream->filename, chunk);
+        return NULL;
+    }
+    char* data = malloc(entry.size > 0 ? entry.size : 1);
+    if (pread(stream->fd, data, entry.size, (off_t)entry.offset) != (ssize_t)entry.size) {
+        fprintf(stderr, "%s: can't read chunk %d\n", stream->filename, chunk);
+        free(data);
+        return NULL;
+    }
+    level_t* level = level_create_from_memory(data, entry.size, stream->filename);
+    free(data);
+    return level;
+}
+
+static int chunk_list_find(const int* list, int count, int chunk)
+{
+    for (int i = 0; i < count; i++) {
+        if (list[i] == chunk)
+            return i;
+    }
+    return -1;
+}
+
+static void chunk_list_remove(int* list, int* count, int index)
+{
+    memmove(list + index, list + index + 1, sizeof(int) * (*count - index - 1));
+    (*count)--;
+}
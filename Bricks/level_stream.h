@@ -0,0 +1,83 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_LEVEL_STREAM_H
+#define BRICKS_LEVEL_STREAM_H
+
+#include "level.h"
+#include "level_format.h"
+#include <pthread.h>
+
+#define LEVEL_STREAM_CHUNK_HEIGHT 512
+// chunks kept loaded above the view, so they are ready before they scroll in
+#define LEVEL_STREAM_AHEAD 2
+// upper bound for the chunks resident at once, which keeps memory use flat for any level size
+#define LEVEL_STREAM_MAX_CHUNKS 16
+
+// Keeps the chunks of a streamed level (see level_format.h) around a scrolling view resident in a
+// level_t. A loader thread reads the chunks ahead of the view, the game thread merges them into the
+// level and drops the chunks the view left behind.
+//
+// The level uses its own coordinates: level y = world y - origin_y. The origin follows the topmost
+// resident chunk, so coordinates stay small enough for the float ball positions however tall the
+// level is.
+typedef struct level_stream {
+    int fd;
+    char *filename;
+    level_stream_header_t header;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake; // the loader has work or should stop
+    pthread_cond_t loaded; // a chunk finished loading
+    short stop;
+    int want_first, want_last; // the chunks the game needs
+    int queue[LEVEL_STREAM_MAX_CHUNKS]; // chunks to load, nearest first
+    int queue_count;
+    level_t *ready[LEVEL_STREAM_MAX_CHUNKS]; // loaded chunks waiting for the game thread
+    int ready_chunk[LEVEL_STREAM_MAX_CHUNKS];
+    int ready_count;
+
+    // owned by the game thread
+    int resident[LEVEL_STREAM_MAX_CHUNKS];
+    int resident_count;
+    int requested[LEVEL_STREAM_MAX_CHUNKS]; // queued or ready, not merged yet
+    int requested_count;
+    int origin_y;
+} level_stream_t;
+
+// Tells whether the file is a streamed level.
+int level_stream_probe(const char *filename);
+level_stream_t *level_stream_open(const char *filename);
+void level_stream_close(level_stream_t *stream);
+// Runs level_verify_binary on every chunk of a streamed level file.
+int level_stream_verify(const char *filename);
+
+// World y the view starts at: the bottom of the level, with its lowest bricks in the upper half of the view.
+int level_stream_start_y(const level_stream_t *stream, int view_height);
+// Makes the chunks in the view at view_y (in level coordinates) resident in the level, blocking until
+// they are, and has the ones ahead of it loaded in the background. Returns how far the level moved
+// down when the origin changed; everything else in level coordinates has to move along.
+int level_stream_update(level_stream_t *stream, level_t *level, int view_y, int view_height);
+
+#endif //BRICKS_LEVEL_STREAM_H
@@ -0,0 +1,149 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "level_watch.h"
+#include "types.h"
+#include <limits.h>
+#include <malloc.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// editors write a file in several steps, the level is parsed once they stay quiet this long
+#define LEVEL_WATCH_SETTLE_MS 20
+
+static void* level_watch_run(void* data);
+static int level_watch_changed(level_watch_t* watch);
+
+level_watch_t* level_watch_create(const char* filename)
+{
+    level_watch_t* watch = calloc(1, sizeof(level_watch_t));
+    watch->filename = strdup(filename);
+    const char* slash = strrchr(watch->filename, '/');
+    watch->name = slash != NULL ? slash + 1 : watch->filename;
+
+    // the directory is watched rather than the file, so saves that replace the file are seen too
+    char directory[PATH_MAX];
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else {
+        snprintf(directory, sizeof(directory), "%.*s", (int)(slash - watch->filename), watch->filename);
+    }
+    watch->inotify_fd = inotify_init1(IN_CLOEXEC);
+    watch->stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (watch->inotify_fd < 0 || watch->stop_fd < 0
+        || inotify_add_watch(watch->inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        fprintf(stderr, "Failed to watch file: %s\n", filename);
+        if (watch->inotify_fd >= 0)
+            close(watch->inotify_fd);
+        if (watch->stop_fd >= 0)
+            close(watch->stop_fd);
+        free(watch->filename);
+        free(watch);
+        return NULL;
+    }
+    pthread_mutex_init(&watch->lock, NULL);
+    pthread_create(&watch->thread, NULL, level_watch_run, watch);
+    return watch;
+}
+
+void level_watch_destroy(level_watch_t* watch)
+{
+    if (watch == NULL)
+        return;
+    uint64_t stop = 1;
+    if (write(watch->stop_fd, &stop, sizeof(stop)) != sizeof(stop)) {
+        fprintf(stderr, "Failed to stop watching file: %s\n", watch->filename);
+    }
+    pthread_join(watch->thread, NULL);
+    pthread_mutex_destroy(&watch->lock);
+    level_destroy(watch->pending);
+    close(watch->inotify_fd);
+    close(watch->stop_fd);
+    free(watch->filename);
+    free(watch);
+}
+
+level_t* level_watch_poll(level_watch_t* watch)
+{
+    if (watch == NULL)
+        return NULL;
+    pthread_mutex_lock(&watch->lock);
+    level_t* level = watch->pending;
+    watch->pending = NULL;
+    pthread_mutex_unlock(&watch->lock);
+    return level;
+}
+
+static void* level_watch_run(void* data)
+{
+    level_watch_t* watch = data;
+    struct pollfd fds[2] = {
+        { .fd = watch->inotify_fd, .events = POLLIN },
+        { .fd = watch->stop_fd, .events = POLLIN },
+    };
+    int changed = FALSE;
+    for (;;) {
+        // once the file changed, wait for the writes to settle before parsing it
+        int ready = poll(fds, 2, changed ? LEVEL_WATCH_SETTLE_MS : -1);
+        if (ready < 0)
+            continue;
+        if (fds[1].revents & POLLIN)
+            break;
+        if (ready > 0) {
+            changed |= level_watch_changed(watch);
+            continue;
+        }
+        changed = FALSE;
+        // a half written or broken file is reported by the parser, the game keeps the current level
+        level_t* level = level_create(watch->filename);
+        if (level == NULL)
+            continue;
+        pthread_mutex_lock(&watch->lock);
+        level_t* replaced = watch->pending;
+        watch->pending = level;
+        pthread_mutex_unlock(&watch->lock);
+        level_destroy(replaced);
+    }
+    return NULL;
+}
+
+// Reads the queued inotify events and tells whether one of them was about the watched file.
+static int level_watch_changed(level_watch_t* watch)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t size = read(watch->inotify_fd, buffer, sizeof(buffer));
+    int changed = FALSE;
+    for (ssize_t offset = 0; offset < size;) {
+        const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+        if (event->len > 0 && strcmp(event->name, watch->name) == 0) {
+            changed = TRUE;
+        }
+        offset += sizeof(struct inotify_event) + event->len;
+    }
+    return changed;
+}
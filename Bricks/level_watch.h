@@ -0,0 +1,47 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_LEVEL_WATCH_H
+#define BRICKS_LEVEL_WATCH_H
+
+#include "level.h"
+#include <pthread.h>
+
+// Watches a level file with inotify and parses every saved version on a background thread.
+// The game picks the parsed level up at a frame boundary and applies it with level_apply.
+typedef struct level_watch {
+    char *filename;
+    const char *name; // file name without the directory, as inotify reports it
+    int inotify_fd;
+    int stop_fd;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    level_t *pending; // newest parsed level, not picked up yet
+} level_watch_t;
+
+level_watch_t *level_watch_create(const char *filename);
+void level_watch_destroy(level_watch_t *watch);
+// Returns the level parsed since the last call or NULL, the caller owns the returned level.
+level_t *level_watch_poll(level_watch_t *watch);
+
+#endif //BRICKS_LEVEL_WATCH_H
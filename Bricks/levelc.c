@@ -0,0 +1,57 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "level.h"
+#include "level_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+// Compiles a CSV level into the binary format level_create can map without parsing, or into a
+// streamed level for outputs ending in .brks. With --verify, checks a compiled or streamed level in full.
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--verify") == 0) {
+        int verified = level_stream_probe(argv[2]) ? level_stream_verify(argv[2]) : level_verify_file(argv[2]);
+        if (verified) {
+            printf("%s: ok\n", argv[2]);
+        }
+        return verified ? 0 : -1;
+    }
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <level.csv> <level.brl|level.brks>\n       %s --verify <level.brl|level.brks>\n", argv[0], argv[0]);
+        return -1;
+    }
+    level_t* level = level_create(argv[1]);
+    if (level == NULL) {
+        return -1;
+    }
+    size_t length = strlen(argv[2]);
+    int written;
+    if (length >= 5 && strcmp(argv[2] + length - 5, ".brks") == 0) {
+        written = level_write_stream(level, argv[2], LEVEL_STREAM_CHUNK_HEIGHT);
+    } else {
+        written = level_write_binary(level, argv[2]);
+    }
+    level_destroy(level);
+    return written ? 0 : -1;
+}
@@ -23,166 +23,502 @@
 // CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
+#include "alloc_stats.h"
+#include "asset.h"
 #include "ball.h"
-#include "brick.h"
+#include "brick_layer.h"
+#include "clock.h"
 #include "event.h"
+#include "game.h"
+#include "input.h"
 #include "level.h"
-#include "paddle.h"
+#include "level_watch.h"
+#include "particle.h"
+#include "profile_overlay.h"
+#include "profiler.h"
 #include "renderer.h"
+#include "replay.h"
+#include "script.h"
+#include "snapshot.h"
+#include "sprite.h"
+#include "startup.h"
+#include "timestep.h"
 #include "types.h"
+#include <stdlib.h>
+#include <string.h>
 
-#define WINDOW_WIDTH 800
-#define WINDOW_HEIGHT 600
+#define WINDOW_WIDTH GAME_WIDTH
+#define WINDOW_HEIGHT GAME_HEIGHT
 #define WINDOW_TITLE "Bricks"
+#define DEFAULT_TICK_RATE 60
+#define DEFAULT_HEADLESS_FRAMES 100000
+#define DEFAULT_BALL_COUNT 1
+// frames before this one may still grow buffers and fill caches
+#define STEADY_STATE_FRAME 120
 
-const int PADDLE_MOV_AMOUNT = 10;
-const int PADDLE_WIDTH = 100;
-const int PADDLE_HEIGHT = 20;
-const int PADDLE_START_X = WINDOW_WIDTH / 2 - PADDLE_WIDTH / 2;
-const int PADDLE_START_Y = WINDOW_HEIGHT - 30;
+unsigned long long steady_state_allocations = 0;
 
-const int BALL_MOV_AMOUNT = 5;
-const int BALL_WIDTH = 10;
-const int BALL_START_X = WINDOW_WIDTH / 2 - BALL_WIDTH / 2;
-const int BALL_START_Y = WINDOW_HEIGHT / 2 - BALL_WIDTH / 2;
-
-int life_count = 10;
-
-const color_t COLOR_BRICK = { .r = 255, .g = 0, .b = 0, .a = 0 };
-const color_t COLOR_BRICK_WEAK = { .r = 155, .g = 0, .b = 0, .a = 0 };
-
-void (*paddle_mov[2])(paddle_t*, int) = { paddle_move_left, paddle_move_right };
-
-void collide_with_bricks(ball_t* ball);
-void collide_with_brick(ball_t* ball, brick_t* brick);
-void draw_bricks(renderer_t* ren);
-
-void collide_with_paddle(paddle_t* paddle, ball_t* ball);
-void check_loose_life(ball_t* ball);
-int has_lost(int);
-void render_life_count(renderer_t* ren);
-
-level_t* level;
+int run_windowed(game_t* game, renderer_t* ren, int tick_rate, long frames, profiler_t* profiler, level_watch_t* watch, const startup_t* startup,
+    replay_t* replay, replay_recorder_t* recorder);
+void reload_level(game_t* game, level_t* level);
+int run_headless(game_t* game, long frames, const char* script_filename, profiler_t* profiler, replay_t* replay, replay_recorder_t* recorder);
+int play_tick(game_t* game, unsigned input_time, replay_t* replay, replay_recorder_t* recorder);
+int write_profile(const profiler_t* profiler, const char* trace_filename, const char* csv_filename);
+void report_snapshots(const snapshot_ring_t* snapshots);
+void report_text(renderer_t* ren);
+void draw_bricks(renderer_t* ren, level_t* level, int view_y);
+void draw_balls(renderer_t* ren, const ball_set_t* balls, double alpha, int view_y);
+void draw_sprites(renderer_t* ren, const sprite_atlas_t* atlas, const paddle_t* paddle, const ball_set_t* balls, double alpha, int view_y);
+void render_life_count(renderer_t* ren, int life_count);
+void check_frame_allocations(long frame, unsigned long long* last_allocations);
 
 int main(int argc, char** argv)
 {
-    if (argc == 1) {
-        level = level_create_random_level(WINDOW_WIDTH, WINDOW_HEIGHT);
+    const char* filename = NULL;
+    const char* script_filename = NULL;
+    const char* trace_filename = NULL;
+    const char* csv_filename = NULL;
+    const char* assets_filename = NULL;
+    const char* record_filename = NULL;
+    const char* frame_directory = NULL;
+    int tick_rate = DEFAULT_TICK_RATE;
+    int headless = FALSE;
+    int software = FALSE;
+    long frames = DEFAULT_HEADLESS_FRAMES;
+    int ball_count = DEFAULT_BALL_COUNT;
+    int trace_startup = FALSE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            tick_rate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = TRUE;
+        } else if (strcmp(argv[i], "--software") == 0) {
+            software = TRUE;
+        } else if (strcmp(argv[i], "--dump-frames") == 0 && i + 1 < argc) {
+            frame_directory = argv[++i];
+            software = TRUE;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script_filename = argv[++i];
+        } else if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc) {
+            ball_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--profile-trace") == 0 && i + 1 < argc) {
+            trace_filename = argv[++i];
+        } else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+            csv_filename = argv[++i];
+        } else if (strcmp(argv[i], "--assets") == 0 && i + 1 < argc) {
+            assets_filename = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_filename = argv[++i];
+        } else if (strcmp(argv[i], "--startup-trace") == 0) {
+            trace_startup = TRUE;
+        } else {
+            filename = argv[i];
+        }
+    }
+    if (tick_rate <= 0 || frames <= 0 || ball_count <= 0) {
+        fprintf(stderr, "Invalid tick rate, frame or ball count!\n");
+        return -1;
+    }
+
+    // the assets are linked in, so the game runs from any directory without opening a file
+    asset_pack_t* assets;
+    if (assets_filename != NULL) {
+        assets = asset_pack_open(assets_filename);
     } else {
-        const char* filename = argv[1];
-        level = level_create(filename);
+        assets = asset_pack_create(asset_embedded_pack, asset_embedded_pack_size);
+    }
+    // the level and the font load on a worker while SDL brings up the window
+    startup_t startup;
+    startup_begin(&startup, assets, filename, WINDOW_WIDTH, WINDOW_HEIGHT, !headless, trace_startup);
+    renderer_t* ren = NULL;
+    if (!headless) {
+        if (software) {
+            ren = renderer_create_software(WINDOW_WIDTH, WINDOW_HEIGHT, frame_directory);
+            startup_stage(&startup, "framebuffer created");
+        } else {
+            ren = renderer_create_window(WINDOW_TITLE, WINDOW_WIDTH, WINDOW_HEIGHT);
+            startup_stage(&startup, "window created");
+        }
     }
-    if (level == NULL) {
-        printf("what?!\n");
+    startup_finish(&startup);
+    level_t* level = startup.level;
+    level_stream_t* stream = startup.stream;
+    replay_t* replay = startup.replay;
+    if (!headless && ren == NULL) {
+        level_destroy(level);
+        level_stream_close(stream);
+        replay_destroy(replay);
+        text_font_destroy(startup.font);
+        asset_pack_destroy(assets);
         return -1;
     }
-    renderer_t* ren = renderer_create(WINDOW_TITLE, WINDOW_WIDTH, WINDOW_HEIGHT);
-    paddle_t* paddle = paddle_create(PADDLE_START_X, PADDLE_START_Y, PADDLE_WIDTH, PADDLE_HEIGHT, WINDOW_WIDTH, COLOR_WHITE);
-    ball_t* ball = ball_create(BALL_START_X, BALL_START_Y, BALL_WIDTH, BALL_WIDTH, WINDOW_WIDTH, WINDOW_HEIGHT, COLOR_WHITE);
-    printf("%d\n", level->brick_count);
+    game_t* game = NULL;
+    if (replay != NULL) {
+        game = replay_create_game(replay);
+    } else if (stream != NULL) {
+        printf("%llu\n", (unsigned long long)stream->header.brick_count);
+        game = game_create_streamed(stream, ball_count);
+    } else if (level != NULL) {
+        printf("%d\n", level->brick_count);
+        game = game_create(level, ball_count);
+    }
+    replay_recorder_t* recorder = NULL;
+    if (game != NULL && record_filename != NULL) {
+        recorder = replay_recorder_create(record_filename, game);
+    }
+    if (game == NULL || (record_filename != NULL && recorder == NULL)) {
+        if (game == NULL) {
+            printf("what?!\n");
+        }
+        game_destroy(game);
+        replay_destroy(replay);
+        text_font_destroy(startup.font);
+        renderer_destroy(ren);
+        asset_pack_destroy(assets);
+        return -1;
+    }
+
+    // the windowed game always profiles so the overlay can be opened at any time
+    profiler_t* profiler = NULL;
+    if (!headless || trace_filename != NULL || csv_filename != NULL) {
+        profiler = profiler_create();
+        profiler_install(profiler);
+    }
+
+    int result;
+    if (headless) {
+        result = run_headless(game, frames, script_filename, profiler, replay, recorder);
+    } else {
+        // a level loaded from a file is reloaded whenever the file is saved, unless that would break a recording
+        level_watch_t* watch = level != NULL && filename != NULL && !startup.level_packed && recorder == NULL ? level_watch_create(filename) : NULL;
+        renderer_set_font(ren, startup.font);
+        result = run_windowed(game, ren, tick_rate, frames, profiler, watch, &startup, replay, recorder);
+        level_watch_destroy(watch);
+        renderer_destroy(ren);
+    }
+    if (!write_profile(profiler, trace_filename, csv_filename)) {
+        result = -1;
+    }
+    if (!replay_recorder_finish(recorder, game)) {
+        result = -1;
+    }
+    // a replay that was played to its end has to arrive at the recorded state
+    if (replay != NULL && (replay->tick == replay->header.tick_count || game_lost(game)) && !replay_verify(replay, game)) {
+        result = -1;
+    }
+    profiler_destroy(profiler);
+    replay_destroy(replay);
+    game_destroy(game);
+    // the font reads from the assets until the renderer is gone
+    asset_pack_destroy(assets);
+    return result;
+}
+
+int run_windowed(game_t* game, renderer_t* ren, int tick_rate, long frames, profiler_t* profiler, level_watch_t* watch, const startup_t* startup,
+    replay_t* replay, replay_recorder_t* recorder)
+{
+    // with the atlas the whole brick field is one geometry call, without it the brick layer takes over;
+    // without render target support either the bricks are drawn one by one every frame, so are scrolling levels
+    sprite_atlas_t* atlas = sprite_atlas_create(ren, startup->assets);
+    sprite_field_t* field = atlas != NULL && game->stream == NULL ? sprite_field_create() : NULL;
+    brick_layer_t* layer = game->stream == NULL && field == NULL ? brick_layer_create(ren, WINDOW_WIDTH, WINDOW_HEIGHT) : NULL;
+    // the balls move a fixed amount per tick, so the tick rate alone sets the game speed
+    timestep_t* timestep = timestep_create(tick_rate);
+    // rewinding or loading a game that is recorded or replayed would break the replay
+    snapshot_ring_t* snapshots = NULL;
+    if (replay == NULL && recorder == NULL && game->stream == NULL) {
+        snapshots = snapshot_ring_create(game, SNAPSHOT_RING_SECONDS * tick_rate);
+    }
+    particle_pool_t* particles = particle_pool_create(PARTICLE_CAPACITY);
+    // nothing waits for a display in software, so every frame is exactly one tick and --frames ends the run
+    short software = ren->framebuffer != NULL;
+    double start = clock_seconds();
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 last_frame = SDL_GetPerformanceCounter();
+    unsigned long long allocations = 0;
+    long frame = 0;
+    short show_profiler = FALSE;
 
     short quit = FALSE;
     while (!quit) {
-        event_t* event = event_poll();
-        if (event->kind == QUIT) {
-            quit = TRUE;
+        profile_scope_t frame_scope = profile_begin(PROFILE_FRAME);
+        profile_scope_t scope = profile_begin(PROFILE_EVENTS);
+        unsigned events = event_poll(&game->input);
+        quit = (events & EVENT_QUIT) != 0;
+        if (events & EVENT_TOGGLE_PROFILER) {
+            show_profiler = !show_profiler;
         }
-        if (event->kind == KEY) {
-            (*paddle_mov[event->key])(paddle, PADDLE_MOV_AMOUNT);
+        if (events & EVENT_SAVE_STATE) {
+            snapshot_ring_save(snapshots);
+        }
+        if (events & EVENT_LOAD_STATE) {
+            snapshot_ring_load(snapshots, game);
+        }
+        profile_end(scope);
+        level_t* reloaded = level_watch_poll(watch);
+        if (reloaded != NULL) {
+            reload_level(game, reloaded);
+            // the snapshots are laid out for the old level
+            if (snapshots != NULL) {
+                report_snapshots(snapshots);
+                snapshot_ring_destroy(snapshots);
+                snapshots = snapshot_ring_create(game, SNAPSHOT_RING_SECONDS * tick_rate);
+            }
         }
-        event_destroy(event);
-
-        collide_with_bricks(ball);
-        ball_move(ball, BALL_MOV_AMOUNT);
-        collide_with_paddle(paddle, ball);
-        check_loose_life(ball);
 
-        if (has_lost(life_count)) {
-            quit = TRUE;
+        Uint64 now = SDL_GetPerformanceCounter();
+        int ticks = timestep_advance(timestep, software ? 1.0 / tick_rate : (double)(now - last_frame) / frequency);
+        last_frame = now;
+        Uint32 now_ms = SDL_GetTicks();
+        for (int tick = 0; tick < ticks && !quit; tick++) {
+            int origin_y = game->stream != NULL ? game->stream->origin_y : 0;
+            // while rewinding every tick goes back one, until the ring runs out
+            if ((events & EVENT_REWIND) && snapshots != NULL) {
+                snapshot_ring_rewind(snapshots, game);
+            } else {
+                // the ticks of a frame catch up with the wall clock, so each one takes the input up to its own time
+                if (!play_tick(game, now_ms - (ticks - 1 - tick) * 1000 / tick_rate, replay, recorder) || game_lost(game)) {
+                    quit = TRUE;
+                }
+                scope = profile_begin(PROFILE_SNAPSHOT);
+                snapshot_ring_capture(snapshots, game);
+                profile_end(scope);
+            }
+            // the particles are in level coordinates, which move along with the origin of a streamed level
+            if (game->stream != NULL && game->stream->origin_y != origin_y) {
+                particle_pool_translate(particles, (float)(origin_y - game->stream->origin_y));
+            }
+            level_t* level = game->level;
+            for (int hit = 0; hit < level->hit_count; hit++) {
+                particle_pool_emit(particles, &level->hits[hit]);
+            }
+            level_clear_hits(level);
+            particle_pool_update(particles);
         }
 
-        renderer_clear(ren, COLOR_BLACK);
+        if (layer != NULL) {
+            // the layer covers the whole window, so it doubles as the clear
+            scope = profile_begin(PROFILE_BRICKS);
+            brick_layer_draw(layer, ren, game->level);
+            profile_end(scope);
+        } else {
+            scope = profile_begin(PROFILE_CLEAR);
+            renderer_clear(ren, COLOR_BLACK);
+            profile_end(scope);
+            scope = profile_begin(PROFILE_BRICKS);
+            if (field != NULL) {
+                sprite_field_draw(field, atlas, ren, game->level);
+            } else {
+                draw_bricks(ren, game->level, game->view_y);
+            }
+            profile_end(scope);
+        }
+        scope = profile_begin(PROFILE_ENTITIES);
+        paddle_t* paddle = game->paddle;
+        if (atlas != NULL) {
+            draw_sprites(ren, atlas, paddle, game->balls, timestep_alpha(timestep), game->view_y);
+        } else {
+            renderer_draw_rect(ren, paddle->x, paddle->y - game->view_y, paddle->width, paddle->height, paddle->color);
+            draw_balls(ren, game->balls, timestep_alpha(timestep), game->view_y);
+        }
+        profile_end(scope);
+        scope = profile_begin(PROFILE_PARTICLE_DRAW);
+        renderer_draw_particles(ren, particles, game->view_y);
+        profile_end(scope);
 
-        render_life_count(ren);
-        renderer_draw_rect(ren, paddle->x, paddle->y, paddle->width, paddle->height, paddle->color);
-        renderer_draw_rect(ren, ball->x, ball->y, ball->width, ball->height, ball->color);
-        draw_bricks(ren);
+        scope = profile_begin(PROFILE_HUD);
+        render_life_count(ren, game->life_count);
+        if (show_profiler && profiler != NULL) {
+            profile_overlay_draw(ren, profiler, WINDOW_WIDTH - 270, 10);
+        }
+        profile_end(scope);
 
+        scope = profile_begin(PROFILE_PRESENT);
         renderer_present(ren);
+        profile_end(scope);
+        profile_end(frame_scope);
+        profiler_end_frame(profiler);
+        if (frame == 0) {
+            startup_stage(startup, "first frame presented");
+        }
+        // chunks of a streamed level and frames written out as PNGs come and go with allocations
+        if (game->stream == NULL && ren->frame_directory == NULL) {
+            check_frame_allocations(frame, &allocations);
+        }
+        frame++;
+        if (software && frame >= frames) {
+            quit = TRUE;
+        }
     }
-    level_destroy(level);
-    paddle_destroy(paddle);
-    ball_destroy(ball);
-    renderer_destroy(ren);
-    return 0;
+    if (software) {
+        double seconds = clock_seconds() - start;
+        printf("software: %ld frames in %.3f s (%.0f frames/s), %d bricks left, %d lives left\n",
+            frame, seconds, seconds > 0 ? frame / seconds : 0.0, game->level->brick_count, game->life_count);
+    }
+    report_snapshots(snapshots);
+    report_text(ren);
+    snapshot_ring_destroy(snapshots);
+    particle_pool_destroy(particles);
+    timestep_destroy(timestep);
+    brick_layer_destroy(layer);
+    sprite_field_destroy(field);
+    sprite_atlas_destroy(atlas);
+    return steady_state_allocations == 0 ? 0 : -1;
 }
 
-void collide_with_paddle(paddle_t* paddle, ball_t* ball)
+int run_headless(game_t* game, long frames, const char* script_filename, profiler_t* profiler, replay_t* replay, replay_recorder_t* recorder)
 {
-    if (ball->x >= paddle->x && ball->x <= paddle->x + paddle->width) {
-        if (ball->y + ball->height >= paddle->y) {
-            ball->y_direction = -1;
+    script_t* script = NULL;
+    if (script_filename != NULL) {
+        script = script_create(script_filename);
+        if (script == NULL) {
+            return -1;
+        }
+    }
+
+    double start = clock_seconds();
+    unsigned long long allocations = 0;
+    while (game->tick < frames && !game_lost(game)) {
+        enum key key;
+        if (script != NULL) {
+            unsigned keys = script_input(script, game->tick, &key) ? 1u << key : 0;
+            game_hold_keys(game, keys, game->tick);
+        }
+        profile_scope_t scope = profile_begin(PROFILE_FRAME);
+        int played = play_tick(game, game->tick, replay, recorder);
+        profile_end(scope);
+        if (!played)
+            break;
+        profiler_end_frame(profiler);
+        if (game->stream == NULL) {
+            check_frame_allocations(game->tick, &allocations);
         }
     }
+    double seconds = clock_seconds() - start;
+
+    printf("headless: %ld ticks in %.3f s (%.0f ticks/s), %d bricks left, %d lives left\n",
+        game->tick, seconds, seconds > 0 ? game->tick / seconds : 0.0, game->level->brick_count, game->life_count);
+    script_destroy(script);
+    return steady_state_allocations == 0 ? 0 : -1;
 }
 
-void check_loose_life(ball_t* ball)
+// Plays one tick with the keys from the replay if there is one, otherwise with the input.
+// Returns FALSE once the replay is over.
+int play_tick(game_t* game, unsigned input_time, replay_t* replay, replay_recorder_t* recorder)
 {
-    if (ball->y + ball->height > WINDOW_HEIGHT) {
-        life_count--;
-        ball->x = BALL_START_X;
-        ball->y = BALL_START_Y;
-        ball->y_direction = -1;
+    unsigned keys;
+    if (replay == NULL) {
+        game_tick(game, input_time);
+    } else if (replay_next(replay, &keys)) {
+        game_step(game, keys);
+    } else {
+        return FALSE;
     }
+    replay_recorder_tick(recorder, game->keys);
+    return TRUE;
 }
 
-int has_lost(int lc)
+void reload_level(game_t* game, level_t* level)
 {
-    return lc == 0;
+    double start = clock_seconds();
+    level_diff_t diff = level_apply(game->level, level);
+    printf("reloaded level: %d added, %d removed, %d changed in %.2f ms\n",
+        diff.added, diff.removed, diff.changed, (clock_seconds() - start) * 1000.0);
+    level_destroy(level);
 }
 
-void draw_bricks(renderer_t* ren)
+int write_profile(const profiler_t* profiler, const char* trace_filename, const char* csv_filename)
 {
-    for (size_t i = 0; i < level->brick_count; i++) {
-        if (level->bricks[i] != NULL) {
-            brick_t* b = level->bricks[i];
-            renderer_draw_rect(ren, b->x, b->y, b->width, b->height, b->color);
-        }
+    if (profiler == NULL)
+        return TRUE;
+    int written = TRUE;
+    if (trace_filename != NULL && !profiler_write_trace(profiler, trace_filename)) {
+        written = FALSE;
     }
+    if (csv_filename != NULL && !profiler_write_csv(profiler, csv_filename)) {
+        written = FALSE;
+    }
+    return written;
 }
 
-void collide_with_bricks(ball_t* ball)
+void report_snapshots(const snapshot_ring_t* snapshots)
 {
-    for (size_t i = 0; i < level->brick_count; i++) {
-        if (level->bricks[i] != NULL) {
-            brick_t* b = level->bricks[i];
-            collide_with_brick(ball, b);
-            if (b->life_count == 0) {
-                brick_destroy(b);
-                level->bricks[i] = NULL;
-            }
-        }
+    if (snapshots == NULL || snapshots->stats.captures == 0)
+        return;
+    const snapshot_stats_t* stats = &snapshots->stats;
+    printf("snapshots: %llu taken, %zu bytes each, %.0f bytes per tick, %.2f us per capture (max %.2f us)\n",
+        stats->captures, snapshot_ring_snapshot_size(snapshots), (double)stats->delta_bytes / stats->captures,
+        stats->capture_ns / 1e3 / stats->captures, stats->max_capture_ns / 1e3);
+}
+
+void report_text(renderer_t* ren)
+{
+    // the software backend draws straight from the font, there is nothing to count
+    text_stats_t stats = renderer_text_stats(ren);
+    if (stats.atlas_uploads == 0)
+        return;
+    printf("text: %lu glyphs from the atlas, %lu missing, %lu atlas uploads, strings %lu cached, %lu rendered, %lu evicted\n",
+        stats.atlas_hits, stats.atlas_misses, stats.atlas_uploads, stats.cache_hits, stats.cache_misses, stats.cache_evictions);
+}
+
+// Only the bricks in view are drawn, the grid finds them.
+void draw_bricks(renderer_t* ren, level_t* level, int view_y)
+{
+    int* bricks;
+    int count = grid_query(level->grid, 0, view_y, WINDOW_WIDTH, WINDOW_HEIGHT, &bricks);
+    renderer_begin_rects(ren);
+    for (int i = 0; i < count; i++) {
+        int b = bricks[i];
+        renderer_push_rect(ren, level->x[b], level->y[b] - view_y, level->width[b], level->height[b], level_brick_color(level, b));
     }
+    renderer_flush_rects(ren);
 }
 
-void collide_with_brick(ball_t* ball, brick_t* brick)
+void draw_balls(renderer_t* ren, const ball_set_t* balls, double alpha, int view_y)
 {
-    if (ball->x >= brick->x && ball->x < brick->x + brick->width) {
-        if (ball->y < brick->y + brick->height && ball->y > brick->y) {
-            ball->y_direction = 1;
-            brick->color = COLOR_BRICK_WEAK;
-            brick->life_count--;
-        } else if (ball->y < brick->y + brick->height && ball->y >= brick->y) {
-            ball->y_direction = -1;
-            brick->color = COLOR_BRICK_WEAK;
-            brick->life_count--;
-        }
+    renderer_begin_rects(ren);
+    for (int i = 0; i < balls->count; i++) {
+        int x, y;
+        ball_interpolate(balls, i, alpha, &x, &y);
+        renderer_push_rect(ren, x, y - view_y, balls->width, balls->height, balls->color);
+    }
+    renderer_flush_rects(ren);
+}
+
+// The paddle and the balls in one geometry call.
+void draw_sprites(renderer_t* ren, const sprite_atlas_t* atlas, const paddle_t* paddle, const ball_set_t* balls, double alpha, int view_y)
+{
+    sprite_begin(ren);
+    sprite_push(ren, atlas, SPRITE_PADDLE, (float)paddle->x, (float)(paddle->y - view_y), (float)paddle->width, (float)paddle->height,
+        paddle->color);
+    for (int i = 0; i < balls->count; i++) {
+        int x, y;
+        ball_interpolate(balls, i, alpha, &x, &y);
+        sprite_push(ren, atlas, SPRITE_BALL, (float)x, (float)(y - view_y), (float)balls->width, (float)balls->height, balls->color);
     }
+    sprite_flush(ren, atlas);
 }
 
-void render_life_count(renderer_t* ren)
+void render_life_count(renderer_t* ren, int life_count)
 {
     char str[10];
     sprintf(str, "Lives: %d", life_count);
-    renderer_draw_text(ren, str, 10, 10, COLOR_WHITE);
+    renderer_draw_static_text(ren, str, 10, 10, COLOR_WHITE);
+}
+
+// Reports frames past the warm-up that allocated. The counters only move in builds configured
+// with BRICKS_COUNT_ALLOCATIONS; any such frame makes the run exit with an error. Only the main
+// thread's allocations count, a level reload or a streamed chunk parsed on another thread doesn't.
+void check_frame_allocations(long frame, unsigned long long* last_allocations)
+{
+    if (!alloc_stats_enabled())
+        return;
+    unsigned long long allocations = alloc_stats_get().allocations;
+    if (frame >= STEADY_STATE_FRAME && allocations != *last_allocations) {
+        fprintf(stderr, "Frame %ld allocated %llu times!\n", frame, allocations - *last_allocations);
+        steady_state_allocations += allocations - *last_allocations;
+    }
+    *last_allocations = allocations;
 }
@@ -0,0 +1,203 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "particle.h"
+#include "profiler.h"
+#include "types.h"
+#include <malloc.h>
+#include <math.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PARTICLE_HAVE_AVX2
+#endif
+
+#define PARTICLE_GRAVITY 0.15f
+#define PARTICLE_MIN_LIFE 30
+#define PARTICLE_MAX_LIFE 60
+
+static float particle_random(particle_pool_t* pool);
+static int particle_update_scalar(particle_pool_t* pool, int begin, int end);
+#if defined(__SSE2__)
+static int particle_update_sse2(particle_pool_t* pool, int begin, int end);
+#endif
+#if defined(PARTICLE_HAVE_AVX2)
+static int particle_update_avx2(particle_pool_t* pool, int begin, int end);
+#endif
+
+particle_pool_t* particle_pool_create(int capacity)
+{
+    particle_pool_t* pool = calloc(1, sizeof(particle_pool_t));
+    float** fields[] = { &pool->x, &pool->y, &pool->velocity_x, &pool->velocity_y, &pool->life };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        *fields[i] = malloc(capacity * sizeof(float));
+    }
+    pool->color = malloc(capacity * sizeof(uint32_t));
+    pool->capacity = capacity;
+    pool->gravity = PARTICLE_GRAVITY;
+    pool->random = 0x9e3779b9u;
+    return pool;
+}
+
+void particle_pool_destroy(particle_pool_t* pool)
+{
+    if (pool == NULL)
+        return;
+    free(pool->x);
+    free(pool->y);
+    free(pool->velocity_x);
+    free(pool->velocity_y);
+    free(pool->life);
+    free(pool->color);
+    free(pool);
+}
+
+// A hit chips a few pieces off the brick, a destroyed brick bursts.
+void particle_pool_emit(particle_pool_t* pool, const level_hit_t* hit)
+{
+    int count = hit->destroyed ? PARTICLES_PER_DESTROY : PARTICLES_PER_HIT;
+    float speed = hit->destroyed ? 3.0f : 1.5f;
+    particle_pool_emit_box(pool, (float)hit->x, (float)hit->y, (float)hit->width, (float)hit->height, hit->color, count, speed);
+}
+
+void particle_pool_emit_box(particle_pool_t* pool, float x, float y, float width, float height, color_t color, int count, float speed)
+{
+    unsigned char rgba[4] = { (unsigned char)color.r, (unsigned char)color.g, (unsigned char)color.b, 255 };
+    uint32_t packed;
+    memcpy(&packed, rgba, sizeof(packed));
+    if (count > pool->capacity - pool->count) {
+        count = pool->capacity - pool->count;
+    }
+    for (int n = 0; n < count; n++) {
+        int i = pool->count++;
+        float angle = particle_random(pool) * 2.0f * (float)M_PI;
+        float magnitude = speed * (0.3f + 0.7f * particle_random(pool));
+        pool->x[i] = x + particle_random(pool) * width;
+        pool->y[i] = y + particle_random(pool) * height;
+        pool->velocity_x[i] = magnitude * cosf(angle);
+        // thrown up a little more than down, gravity does the rest
+        pool->velocity_y[i] = magnitude * sinf(angle) - speed * 0.5f;
+        pool->life[i] = (float)PARTICLE_MIN_LIFE + particle_random(pool) * (PARTICLE_MAX_LIFE - PARTICLE_MIN_LIFE);
+        pool->color[i] = packed;
+    }
+}
+
+// Moves every particle by a tick in one pass over the arrays, then fills the holes the dead ones
+// leave with the last ones.
+void particle_pool_update(particle_pool_t* pool)
+{
+    profile_scope_t scope = profile_begin(PROFILE_PARTICLES);
+    int begin = 0;
+#if defined(PARTICLE_HAVE_AVX2)
+    if (pool->count >= 8 && __builtin_cpu_supports("avx2"))
+        begin = particle_update_avx2(pool, begin, pool->count);
+#endif
+#if defined(__SSE2__)
+    if (pool->count - begin >= 4)
+        begin = particle_update_sse2(pool, begin, pool->count);
+#endif
+    particle_update_scalar(pool, begin, pool->count);
+
+    for (int i = 0; i < pool->count;) {
+        if (pool->life[i] > 0.0f) {
+            i++;
+            continue;
+        }
+        int last = --pool->count;
+        pool->x[i] = pool->x[last];
+        pool->y[i] = pool->y[last];
+        pool->velocity_x[i] = pool->velocity_x[last];
+        pool->velocity_y[i] = pool->velocity_y[last];
+        pool->life[i] = pool->life[last];
+        pool->color[i] = pool->color[last];
+    }
+    profile_end(scope);
+}
+
+void particle_pool_translate(particle_pool_t* pool, float dy)
+{
+    for (int i = 0; i < pool->count; i++) {
+        pool->y[i] += dy;
+    }
+}
+
+// xorshift, in [0, 1)
+static float particle_random(particle_pool_t* pool)
+{
+    unsigned x = pool->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    pool->random = x;
+    return (float)(x >> 8) / (float)(1u << 24);
+}
+
+// The kernels below all do the same thing and return the index of the first particle they didn't
+// get to, which the narrower ones pick up.
+static int particle_update_scalar(particle_pool_t* pool, int begin, int end)
+{
+    for (int i = begin; i < end; i++) {
+        pool->velocity_y[i] += pool->gravity;
+        pool->x[i] += pool->velocity_x[i];
+        pool->y[i] += pool->velocity_y[i];
+        pool->life[i] -= 1.0f;
+    }
+    return end;
+}
+
+#if defined(__SSE2__)
+static int particle_update_sse2(particle_pool_t* pool, int begin, int end)
+{
+    const __m128 gravity = _mm_set1_ps(pool->gravity);
+    const __m128 one = _mm_set1_ps(1.0f);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 velocity_y = _mm_add_ps(_mm_loadu_ps(pool->velocity_y + i), gravity);
+        _mm_storeu_ps(pool->velocity_y + i, velocity_y);
+        _mm_storeu_ps(pool->x + i, _mm_add_ps(_mm_loadu_ps(pool->x + i), _mm_loadu_ps(pool->velocity_x + i)));
+        _mm_storeu_ps(pool->y + i, _mm_add_ps(_mm_loadu_ps(pool->y + i), velocity_y));
+        _mm_storeu_ps(pool->life + i, _mm_sub_ps(_mm_loadu_ps(pool->life + i), one));
+    }
+    return i;
+}
+#endif
+
+#if defined(PARTICLE_HAVE_AVX2)
+__attribute__((target("avx2"))) static int particle_update_avx2(particle_pool_t* pool, int begin, int end)
+{
+    const __m256 gravity = _mm256_set1_ps(pool->gravity);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 velocity_y = _mm256_add_ps(_mm256_loadu_ps(pool->velocity_y + i), gravity);
+        _mm256_storeu_ps(pool->velocity_y + i, velocity_y);
+        _mm256_storeu_ps(pool->x + i, _mm256_add_ps(_mm256_loadu_ps(pool->x + i), _mm256_loadu_ps(pool->velocity_x + i)));
+        _mm256_storeu_ps(pool->y + i, _mm256_add_ps(_mm256_loadu_ps(pool->y + i), velocity_y));
+        _mm256_storeu_ps(pool->life + i, _mm256_sub_ps(_mm256_loadu_ps(pool->life + i), one));
+    }
+    return i;
+}
+#endif
@@ -0,0 +1,55 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_PARTICLE_H
+#define BRICKS_PARTICLE_H
+
+#include "level.h"
+#include <stdint.h>
+
+#define PARTICLE_CAPACITY 131072
+#define PARTICLE_SIZE 3
+#define PARTICLES_PER_HIT 6
+#define PARTICLES_PER_DESTROY 32
+
+// Debris of hit bricks, in arrays of the pool's fixed capacity. A full pool drops new particles.
+typedef struct particle_pool {
+    float *x, *y;
+    float *velocity_x, *velocity_y; // pixels per tick
+    float *life; // ticks left
+    uint32_t *color; // r, g, b, a bytes in memory order
+    int count, capacity;
+    float gravity;
+    unsigned random;
+} particle_pool_t;
+
+particle_pool_t *particle_pool_create(int capacity);
+void particle_pool_destroy(particle_pool_t *pool);
+
+void particle_pool_emit(particle_pool_t *pool, const level_hit_t *hit);
+void particle_pool_emit_box(particle_pool_t *pool, float x, float y, float width, float height, color_t color, int count, float speed);
+void particle_pool_update(particle_pool_t *pool);
+// Moves every particle down by dy, for when the level coordinates they live in move.
+void particle_pool_translate(particle_pool_t *pool, float dy);
+
+#endif //BRICKS_PARTICLE_H
@@ -0,0 +1,126 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "pool.h"
+#include "types.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <unistd.h>
+
+typedef struct pool_worker {
+    pool_t *pool;
+    int index;
+} pool_worker_t;
+
+static void* pool_work(void* data);
+static int pool_take(pool_deque_t* deque, int* job);
+static int pool_steal(pool_deque_t* deque, int* job);
+
+int pool_default_workers(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+// Runs jobs [0, job_count) on worker_count threads and returns once all of them are done. Every
+// worker starts with an even, contiguous share; whoever runs out early steals from the others.
+void pool_run(int worker_count, int job_count, pool_job_t run, void* context)
+{
+    if (worker_count < 1)
+        worker_count = 1;
+    pool_t pool = { .worker_count = worker_count, .run = run, .context = context };
+    pool.deques = calloc(worker_count, sizeof(pool_deque_t));
+    for (int w = 0; w < worker_count; w++) {
+        pool_deque_t* deque = &pool.deques[w];
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->head = (int)((long)job_count * w / worker_count);
+        deque->tail = (int)((long)job_count * (w + 1) / worker_count);
+    }
+
+    pthread_t* threads = malloc(worker_count * sizeof(pthread_t));
+    pool_worker_t* workers = malloc(worker_count * sizeof(pool_worker_t));
+    int started = 0;
+    for (int w = 1; w < worker_count; w++) {
+        workers[w] = (pool_worker_t) { &pool, w };
+        if (pthread_create(&threads[w], NULL, pool_work, &workers[w]) != 0) {
+            // the workers that did start steal this one's share
+            fprintf(stderr, "Failed to start worker %d, continuing with fewer threads\n", w);
+            break;
+        }
+        started = w;
+    }
+    // the calling thread is worker 0
+    workers[0] = (pool_worker_t) { &pool, 0 };
+    pool_work(&workers[0]);
+    for (int w = 1; w <= started; w++) {
+        pthread_join(threads[w], NULL);
+    }
+
+    for (int w = 0; w < worker_count; w++) {
+        pthread_mutex_destroy(&pool.deques[w].lock);
+    }
+    free(workers);
+    free(threads);
+    free(pool.deques);
+}
+
+static void* pool_work(void* data)
+{
+    pool_worker_t* worker = data;
+    pool_t* pool = worker->pool;
+    int job;
+    for (;;) {
+        if (pool_take(&pool->deques[worker->index], &job)) {
+            pool->run(pool->context, job, worker->index);
+            continue;
+        }
+        // no job is ever added, so once every deque came up empty the work is done
+        int stolen = FALSE;
+        for (int i = 1; i < pool->worker_count && !stolen; i++) {
+            stolen = pool_steal(&pool->deques[(worker->index + i) % pool->worker_count], &job);
+        }
+        if (!stolen)
+            return NULL;
+        pool->run(pool->context, job, worker->index);
+    }
+}
+
+static int pool_take(pool_deque_t* deque, int* job)
+{
+    pthread_mutex_lock(&deque->lock);
+    int found = deque->head < deque->tail;
+    if (found)
+        *job = --deque->tail;
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int pool_steal(pool_deque_t* deque, int* job)
+{
+    pthread_mutex_lock(&deque->lock);
+    int found = deque->head < deque->tail;
+    if (found)
+        *job = deque->head++;
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "profile_overlay.h"
+#include <stdio.h>
+
+#define OVERLAY_WIDTH 260
+#define OVERLAY_LINE_HEIGHT 14
+#define OVERLAY_PADDING 6
+#define OVERLAY_GRAPH_HEIGHT 60
+#define OVERLAY_BAR_WIDTH 2
+// the graph is scaled so a 60 Hz frame fills half of it
+#define OVERLAY_BUDGET_MS (1000.0f / 60.0f)
+// phase timings are averaged over this many frames to keep the numbers readable
+#define OVERLAY_AVERAGE_FRAMES 30
+
+static const color_t PHASE_COLORS[PROFILE_PHASE_COUNT] = {
+    { 255, 255, 255, 255 }, { 120, 120, 255, 255 }, { 80, 200, 80, 255 }, { 230, 60, 60, 255 }, { 230, 150, 40, 255 },
+    { 160, 110, 255, 255 }, { 255, 190, 120, 255 }, { 100, 100, 100, 255 }, { 155, 0, 0, 255 }, { 200, 200, 60, 255 },
+    { 255, 120, 170, 255 }, { 60, 200, 200, 255 }, { 200, 80, 200, 255 },
+};
+static const color_t BACKGROUND = { 20, 20, 20, 255 };
+static const color_t BUDGET_LINE = { 90, 90, 90, 255 };
+
+// Draws the average time of every phase and a graph of the recent frame times.
+void profile_overlay_draw(renderer_t* ren, const profiler_t* profiler, int x, int y)
+{
+    int height = OVERLAY_PADDING * 3 + PROFILE_PHASE_COUNT * OVERLAY_LINE_HEIGHT + OVERLAY_GRAPH_HEIGHT;
+    renderer_draw_rect(ren, x, y, OVERLAY_WIDTH, height, BACKGROUND);
+
+    int line_y = y + OVERLAY_PADDING;
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++) {
+        float total = 0;
+        for (int frame = 0; frame < OVERLAY_AVERAGE_FRAMES; frame++) {
+            total += profiler_frame_ms(profiler, frame)[phase];
+        }
+        char line[48];
+        snprintf(line, sizeof(line), "%-16s %6.3f ms", profiler_phase_name(phase), total / OVERLAY_AVERAGE_FRAMES);
+        renderer_draw_rect(ren, x + OVERLAY_PADDING, line_y + 3, 8, 8, PHASE_COLORS[phase]);
+        renderer_draw_text(ren, line, x + OVERLAY_PADDING + 14, line_y, COLOR_WHITE);
+        line_y += OVERLAY_LINE_HEIGHT;
+    }
+
+    int graph_bottom = line_y + OVERLAY_PADDING + OVERLAY_GRAPH_HEIGHT;
+    int budget_height = OVERLAY_GRAPH_HEIGHT / 2;
+    renderer_draw_rect(ren, x + OVERLAY_PADDING, graph_bottom - budget_height, OVERLAY_WIDTH - 2 * OVERLAY_PADDING, 1, BUDGET_LINE);
+    int bars = (OVERLAY_WIDTH - 2 * OVERLAY_PADDING) / OVERLAY_BAR_WIDTH;
+    if (bars > PROFILER_HISTORY)
+        bars = PROFILER_HISTORY;
+    // newest frame on the right
+    for (int bar = 0; bar < bars; bar++) {
+        float ms = profiler_frame_ms(profiler, bar)[PROFILE_FRAME];
+        int bar_height = (int)(ms / OVERLAY_BUDGET_MS * budget_height);
+        if (bar_height > OVERLAY_GRAPH_HEIGHT)
+            bar_height = OVERLAY_GRAPH_HEIGHT;
+        int bar_x = x + OVERLAY_WIDTH - OVERLAY_PADDING - (bar + 1) * OVERLAY_BAR_WIDTH;
+        color_t color = ms > OVERLAY_BUDGET_MS ? PHASE_COLORS[PROFILE_BRICK_COLLISION] : PHASE_COLORS[PROFILE_BALL_MOVE];
+        renderer_draw_rect(ren, bar_x, graph_bottom - bar_height, OVERLAY_BAR_WIDTH, bar_height, color);
+    }
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "profiler.h"
+#include "types.h"
+#include <malloc.h>
+#include <stdio.h>
+
+profiler_t* profiler_active = NULL;
+
+static const char* PHASE_NAMES[PROFILE_PHASE_COUNT] = {
+    "frame", "events", "ball move", "brick collision", "paddle collision", "snapshot", "particles", "clear", "bricks", "paddle+balls",
+    "particle draw", "hud", "present"
+};
+
+static unsigned profiler_thread_count = 0;
+static __thread int profiler_thread = -1;
+
+static const profile_event_t* profiler_event(const profiler_t* profiler, unsigned long long index);
+static unsigned long long profiler_first_event(const profiler_t* profiler);
+
+profiler_t* profiler_create(void)
+{
+    profiler_t* profiler = calloc(1, sizeof(profiler_t));
+    profiler->events = calloc(PROFILER_RING_SIZE, sizeof(profile_event_t));
+    profiler->epoch_ns = clock_nanoseconds();
+    return profiler;
+}
+
+void profiler_destroy(profiler_t* profiler)
+{
+    if (profiler == NULL)
+        return;
+    if (profiler_active == profiler)
+        profiler_active = NULL;
+    free(profiler->events);
+    free(profiler);
+}
+
+void profiler_install(profiler_t* profiler)
+{
+    profiler_active = profiler;
+}
+
+void profiler_record(profiler_t* profiler, enum profile_phase phase, unsigned long long start_ns, unsigned long long end_ns)
+{
+    if (profiler_thread < 0)
+        profiler_thread = (int)__atomic_fetch_add(&profiler_thread_count, 1, __ATOMIC_RELAXED);
+    unsigned long long index = __atomic_fetch_add(&profiler->next_event, 1, __ATOMIC_RELAXED);
+    profile_event_t* event = &profiler->events[index & (PROFILER_RING_SIZE - 1)];
+    event->start_ns = start_ns - profiler->epoch_ns;
+    event->duration_ns = end_ns - start_ns;
+    event->frame = __atomic_load_n(&profiler->frame, __ATOMIC_RELAXED);
+    event->phase = (unsigned short)phase;
+    event->thread = (unsigned short)profiler_thread;
+    __atomic_fetch_add(&profiler->phase_ns[phase], end_ns - start_ns, __ATOMIC_RELAXED);
+}
+
+// Moves the totals of the finished frame into the history. Called once per frame by the main loop.
+void profiler_end_frame(profiler_t* profiler)
+{
+    if (profiler == NULL)
+        return;
+    float* history = profiler->history_ms[profiler->history_head];
+    for (int phase = 0; phase < PROFILE_PHASE_COUNT; phase++) {
+        history[phase] = __atomic_exchange_n(&profiler->phase_ns[phase], 0, __ATOMIC_RELAXED) / 1e6f;
+    }
+    profiler->history_head = (profiler->history_head + 1) % PROFILER_HISTORY;
+    __atomic_store_n(&profiler->frame, profiler->frame + 1, __ATOMIC_RELAXED);
+}
+
+// Milliseconds spent per phase in a finished frame, 0 being the latest one.
+const float* profiler_frame_ms(const profiler_t* profiler, int frames_ago)
+{
+    int index = (profiler->history_head - 1 - frames_ago) % PROFILER_HISTORY;
+    return profiler->history_ms[index < 0 ? index + PROFILER_HISTORY : index];
+}
+
+const char* profiler_phase_name(enum profile_phase phase)
+{
+    return PHASE_NAMES[phase];
+}
+
+// Writes the recorded scopes in the Chrome trace event format (chrome://tracing, Perfetto).
+int profiler_write_trace(const profiler_t* profiler, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return FALSE;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    unsigned long long end = profiler->next_event;
+    for (unsigned long long i = profiler_first_event(profiler); i < end; i++) {
+        const profile_event_t* event = profiler_event(profiler, i);
+        fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+            i == profiler_first_event(profiler) ? "" : ",", PHASE_NAMES[event->phase], event->thread,
+            event->start_ns / 1e3, event->duration_ns / 1e3, event->frame);
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+int profiler_write_csv(const profiler_t* profiler, const char* filename)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return FALSE;
+    }
+    fprintf(file, "frame,phase,thread,start_us,duration_us\n");
+    unsigned long long end = profiler->next_event;
+    for (unsigned long long i = profiler_first_event(profiler); i < end; i++) {
+        const profile_event_t* event = profiler_event(profiler, i);
+        fprintf(file, "%u,%s,%d,%.3f,%.3f\n", event->frame, PHASE_NAMES[event->phase], event->thread,
+            event->start_ns / 1e3, event->duration_ns / 1e3);
+    }
+    return fclose(file) == 0;
+}
+
+static const profile_event_t* profiler_event(const profiler_t* profiler, unsigned long long index)
+{
+    return &profiler->events[index & (PROFILER_RING_SIZE - 1)];
+}
+
+// older scopes have been overwritten
+static unsigned long long profiler_first_event(const profiler_t* profiler)
+{
+    return profiler->next_event > PROFILER_RING_SIZE ? profiler->next_event - PROFILER_RING_SIZE : 0;
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_PROFILER_H
+#define BRICKS_PROFILER_H
+
+#include "clock.h"
+#include <stddef.h>
+
+// must be a power of two
+#define PROFILER_RING_SIZE 65536
+#define PROFILER_HISTORY 120
+
+enum profile_phase {
+    PROFILE_FRAME,
+    PROFILE_EVENTS,
+    PROFILE_BALL_MOVE,
+    PROFILE_BRICK_COLLISION,
+    PROFILE_PADDLE_COLLISION,
+    PROFILE_SNAPSHOT,
+    PROFILE_PARTICLES,
+    PROFILE_CLEAR,
+    PROFILE_BRICKS,
+    PROFILE_ENTITIES,
+    PROFILE_PARTICLE_DRAW,
+    PROFILE_HUD,
+    PROFILE_PRESENT,
+    PROFILE_PHASE_COUNT
+};
+
+typedef struct profile_event {
+    unsigned long long start_ns, duration_ns;
+    unsigned frame;
+    unsigned short phase;
+    unsigned short thread;
+} profile_event_t;
+
+// Scopes from any thread claim a slot with one atomic add, so recording never blocks. The ring
+// keeps the most recent PROFILER_RING_SIZE scopes; the per-frame totals feed the overlay.
+typedef struct profiler {
+    profile_event_t *events;
+    unsigned long long next_event;
+    unsigned long long epoch_ns;
+    unsigned long long phase_ns[PROFILE_PHASE_COUNT]; // totals of the frame in progress
+    float history_ms[PROFILER_HISTORY][PROFILE_PHASE_COUNT];
+    int history_head;
+    unsigned frame;
+} profiler_t;
+
+typedef struct profile_scope {
+    unsigned long long start_ns;
+    enum profile_phase phase;
+} profile_scope_t;
+
+// scopes are only recorded while a profiler is installed
+extern profiler_t *profiler_active;
+
+profiler_t *profiler_create(void);
+void profiler_destroy(profiler_t *profiler);
+void profiler_install(profiler_t *profiler);
+
+void profiler_record(profiler_t *profiler, enum profile_phase phase, unsigned long long start_ns, unsigned long long end_ns);
+void profiler_end_frame(profiler_t *profiler);
+const float *profiler_frame_ms(const profiler_t *profiler, int frames_ago);
+const char *profiler_phase_name(enum profile_phase phase);
+
+int profiler_write_trace(const profiler_t *profiler, const char *filename);
+int profiler_write_csv(const profiler_t *profiler, const char *filename);
+
+static inline profile_scope_t profile_begin(enum profile_phase phase)
+{
+    profile_scope_t scope = { profiler_active != NULL ? clock_nanoseconds() : 0, phase };
+    return scope;
+}
+
+static inline void profile_end(profile_scope_t scope)
+{
+    if (profiler_active != NULL && scope.start_ns != 0)
+        profiler_record(profiler_active, scope.phase, scope.start_ns, clock_nanoseconds());
+}
+
+#endif //BRICKS_PROFILER_H
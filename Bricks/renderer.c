@@ -24,15 +24,65 @@
 #include "renderer.h"
 #include <SDL2/SDL_ttf.h>
 #include <stdio.h>
+#include <string.h>
 
 #define WINDOW_POS(screen_dimension, window_dimension) (screen_dimension / 2) - (window_dimension / 2)
 #define DISPLAY_INDEX 0
 #define RENDERER_INDEX -1
+#define FONT_ASSET "roboto.ttf"
+#define FONT_FILENAME "Resources/" FONT_ASSET
 #define FONT_SIZE 12
+#define RECT_BATCH_INITIAL_CAPACITY 256
+#define FRAME_FILENAME_SIZE 512
 
-SDL_Color convert_to_sdl_color(color_t color);
+static int compare_rect_commands(const void* a, const void* b);
+static void renderer_sdl_destroy(renderer_t* ren);
+static void renderer_sdl_set_font(renderer_t* ren, text_font_t* font);
+static void renderer_sdl_clear(renderer_t* ren, color_t color);
+static void renderer_sdl_fill_rects(renderer_t* ren, const SDL_Rect* rects, int count, color_t color);
+static void renderer_sdl_draw_text(renderer_t* ren, const char* text, int x, int y, color_t color, int cached);
+static void renderer_sdl_draw_quads(renderer_t* ren, int count);
+static void renderer_sdl_present(renderer_t* ren);
+static void renderer_software_destroy(renderer_t* ren);
+static void renderer_software_set_font(renderer_t* ren, text_font_t* font);
+static void renderer_software_clear(renderer_t* ren, color_t color);
+static void renderer_software_fill_rects(renderer_t* ren, const SDL_Rect* rects, int count, color_t color);
+static void renderer_software_draw_text(renderer_t* ren, const char* text, int x, int y, color_t color, int cached);
+static void renderer_software_draw_quads(renderer_t* ren, int count);
+static void renderer_software_present(renderer_t* ren);
+
+static const renderer_backend_t SDL_BACKEND = {
+    .name = "sdl",
+    .destroy = renderer_sdl_destroy,
+    .set_font = renderer_sdl_set_font,
+    .clear = renderer_sdl_clear,
+    .fill_rects = renderer_sdl_fill_rects,
+    .draw_text = renderer_sdl_draw_text,
+    .draw_quads = renderer_sdl_draw_quads,
+    .present = renderer_sdl_present,
+};
+
+static const renderer_backend_t SOFTWARE_BACKEND = {
+    .name = "software",
+    .destroy = renderer_software_destroy,
+    .set_font = renderer_software_set_font,
+    .clear = renderer_software_clear,
+    .fill_rects = renderer_software_fill_rects,
+    .draw_text = renderer_software_draw_text,
+    .draw_quads = renderer_software_draw_quads,
+    .present = renderer_software_present,
+};
 
 renderer_t* renderer_create(const char* title, int width, int height)
+{
+    renderer_t* ren = renderer_create_window(title, width, height);
+    if (ren != NULL) {
+        renderer_set_font(ren, renderer_load_font(NULL));
+    }
+    return ren;
+}
+
+renderer_t* renderer_create_window(const char* title, int width, int height)
 {
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         fprintf(stderr, "Failed to initialize SDL!\n");
@@ -58,80 +108,301 @@ renderer_t* renderer_create(const char* title, int width, int height)
         return NULL;
     }
 
+    renderer_t* ren = calloc(1, sizeof(renderer_t));
+    ren->backend = &SDL_BACKEND;
+    ren->window = window;
+    ren->renderer = renderer;
+    return ren;
+}
+
+renderer_t* renderer_create_software(int width, int height, const char* frame_directory)
+{
+    framebuffer_t* framebuffer = framebuffer_create(width, height);
+    if (framebuffer == NULL)
+        return NULL;
+    renderer_t* ren = calloc(1, sizeof(renderer_t));
+    ren->backend = &SOFTWARE_BACKEND;
+    ren->framebuffer = framebuffer;
+    ren->frame_directory = frame_directory;
+    return ren;
+}
+
+text_font_t* renderer_load_font(const asset_pack_t* assets)
+{
     if (TTF_Init() != 0) {
         fprintf(stderr, "Failed to initialize TTF!\n");
         return NULL;
     }
+    const void* data;
+    size_t size;
+    if (asset_find(assets, FONT_ASSET, &data, &size)) {
+        return text_font_load_rw(SDL_RWFromConstMem(data, (int)size), FONT_SIZE);
+    }
+    return text_font_load(FONT_FILENAME, FONT_SIZE);
+}
 
-    renderer_t* ren = malloc(sizeof(renderer_t));
-    ren->window = window;
-    ren->renderer = renderer;
-    return ren;
+void renderer_set_font(renderer_t* ren, text_font_t* font)
+{
+    ren->backend->set_font(ren, font);
 }
 
 void renderer_destroy(renderer_t* renderer)
 {
     if (renderer == NULL)
         return;
-    SDL_DestroyRenderer(renderer->renderer);
-    SDL_DestroyWindow(renderer->window);
-    SDL_Quit();
+    free(renderer->batch.commands);
+    free(renderer->batch.rects);
+    free(renderer->quads.vertices);
+    free(renderer->quads.indices);
+    renderer->backend->destroy(renderer);
     free(renderer);
 }
 
 void renderer_draw_rect(renderer_t* ren, int x, int y, int width, int height, color_t color)
 {
     SDL_Rect rect = { .x = x, .y = y, .w = width, .h = height };
+    ren->backend->fill_rects(ren, &rect, 1, color);
+}
+
+void renderer_begin_rects(renderer_t* ren)
+{
+    ren->batch.count = 0;
+}
+
+void renderer_push_rect(renderer_t* ren, int x, int y, int width, int height, color_t color)
+{
+    rect_batch_t* batch = &ren->batch;
+    if (batch->count == batch->capacity) {
+        int capacity = batch->capacity == 0 ? RECT_BATCH_INITIAL_CAPACITY : batch->capacity * 2;
+        batch->commands = realloc(batch->commands, capacity * sizeof(rect_command_t));
+        batch->rects = realloc(batch->rects, capacity * sizeof(SDL_Rect));
+        batch->capacity = capacity;
+    }
+    rect_command_t* command = &batch->commands[batch->count++];
+    command->rect.x = x;
+    command->rect.y = y;
+    command->rect.w = width;
+    command->rect.h = height;
+    command->color = (Uint32)(color.r & 0xff) << 24 | (Uint32)(color.g & 0xff) << 16 | (Uint32)(color.b & 0xff) << 8 | (Uint32)(color.a & 0xff);
+}
+
+int renderer_flush_rects(renderer_t* ren)
+{
+    rect_batch_t* batch = &ren->batch;
+    batch->draw_calls = 0;
+    if (batch->count == 0)
+        return 0;
+
+    qsort(batch->commands, batch->count, sizeof(rect_command_t), compare_rect_commands);
+    for (int i = 0; i < batch->count; i++) {
+        batch->rects[i] = batch->commands[i].rect;
+    }
+
+    int start = 0;
+    while (start < batch->count) {
+        Uint32 color = batch->commands[start].color;
+        int end = start + 1;
+        while (end < batch->count && batch->commands[end].color == color) {
+            end++;
+        }
+        color_t unpacked = { .r = color >> 24, .g = (color >> 16) & 0xff, .b = (color >> 8) & 0xff, .a = color & 0xff };
+        ren->backend->fill_rects(ren, batch->rects + start, end - start, unpacked);
+        batch->draw_calls++;
+        start = end;
+    }
+    batch->count = 0;
+    return batch->draw_calls;
+}
+
+// All particles go out in a single call, as two triangles each.
+void renderer_draw_particles(renderer_t* ren, const particle_pool_t* particles, int offset_y)
+{
+    if (particles->count == 0)
+        return;
+    quad_batch_reserve(&ren->quads, particles->count);
+    SDL_Vertex* vertex = ren->quads.vertices;
+    const float size = PARTICLE_SIZE;
+    for (int i = 0; i < particles->count; i++) {
+        float x = particles->x[i];
+        float y = particles->y[i] - (float)offset_y;
+        SDL_Color color;
+        memcpy(&color, &particles->color[i], sizeof(color));
+        vertex[0] = (SDL_Vertex) { { x, y }, color, { 0, 0 } };
+        vertex[1] = (SDL_Vertex) { { x + size, y }, color, { 0, 0 } };
+        vertex[2] = (SDL_Vertex) { { x, y + size }, color, { 0, 0 } };
+        vertex[3] = (SDL_Vertex) { { x + size, y + size }, color, { 0, 0 } };
+        vertex += 4;
+    }
+    ren->backend->draw_quads(ren, particles->count);
+}
+
+void quad_batch_reserve(quad_batch_t* quads, int count)
+{
+    if (count <= quads->capacity)
+        return;
+    int capacity = quads->capacity == 0 ? RECT_BATCH_INITIAL_CAPACITY : quads->capacity;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    quads->vertices = realloc(quads->vertices, sizeof(SDL_Vertex) * 4 * capacity);
+    quads->indices = realloc(quads->indices, sizeof(int) * 6 * capacity);
+    for (int quad = quads->capacity; quad < capacity; quad++) {
+        int* index = quads->indices + quad * 6;
+        int first = quad * 4;
+        index[0] = first;
+        index[1] = first + 1;
+        index[2] = first + 2;
+        index[3] = first + 2;
+        index[4] = first + 1;
+        index[5] = first + 3;
+    }
+    quads->capacity = capacity;
+}
+
+void renderer_clear(renderer_t* ren, color_t clear_color)
+{
+    ren->backend->clear(ren, clear_color);
+}
+
+void renderer_present(renderer_t* ren)
+{
+    ren->backend->present(ren);
+    ren->frame++;
+}
+
+void renderer_draw_text(renderer_t* ren, const char* text, int x, int y, color_t color)
+{
+    ren->backend->draw_text(ren, text, x, y, color, FALSE);
+}
+
+void renderer_draw_static_text(renderer_t* ren, const char* text, int x, int y, color_t color)
+{
+    ren->backend->draw_text(ren, text, x, y, color, TRUE);
+}
+
+text_stats_t renderer_text_stats(renderer_t* ren)
+{
+    text_stats_t empty = { 0 };
+    if (ren->text == NULL)
+        return empty;
+    return ren->text->stats;
+}
+
+static int compare_rect_commands(const void* a, const void* b)
+{
+    Uint32 color_a = ((const rect_command_t*)a)->color;
+    Uint32 color_b = ((const rect_command_t*)b)->color;
+    return (color_a > color_b) - (color_a < color_b);
+}
+
+static void renderer_sdl_destroy(renderer_t* ren)
+{
+    text_destroy(ren->text);
+    TTF_Quit();
+    SDL_DestroyRenderer(ren->renderer);
+    SDL_DestroyWindow(ren->window);
+    SDL_Quit();
+}
+
+static void renderer_sdl_set_font(renderer_t* ren, text_font_t* font)
+{
+    ren->text = text_create_from_font(ren->renderer, font);
+    if (ren->text == NULL) {
+        fprintf(stderr, "Text rendering is disabled!\n");
+    }
+}
+
+static void renderer_sdl_clear(renderer_t* ren, color_t color)
+{
+    SDL_SetRenderDrawColor(ren->renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderClear(ren->renderer);
+}
+
+static void renderer_sdl_fill_rects(renderer_t* ren, const SDL_Rect* rects, int count, color_t color)
+{
     unsigned char old_r, old_g, old_b, old_a;
     SDL_GetRenderDrawColor(ren->renderer, &old_r, &old_g, &old_b, &old_a);
     SDL_SetRenderDrawColor(ren->renderer, color.r, color.g, color.b, color.a);
-    SDL_RenderFillRect(ren->renderer, &rect);
+    SDL_RenderFillRects(ren->renderer, rects, count);
     SDL_SetRenderDrawColor(ren->renderer, old_r, old_g, old_b, old_a);
 }
 
-void renderer_clear(renderer_t* ren, color_t clear_color)
+static void renderer_sdl_draw_text(renderer_t* ren, const char* text, int x, int y, color_t color, int cached)
 {
-    SDL_SetRenderDrawColor(ren->renderer, clear_color.r, clear_color.g, clear_color.b, clear_color.a);
-    SDL_RenderClear(ren->renderer);
+    if (ren->text == NULL)
+        return;
+    if (cached) {
+        text_draw_cached(ren->text, ren->renderer, text, x, y, color);
+    } else {
+        text_draw(ren->text, ren->renderer, text, x, y, color);
+    }
 }
 
-void renderer_present(renderer_t* ren)
+static void renderer_sdl_draw_quads(renderer_t* ren, int count)
+{
+    SDL_RenderGeometry(ren->renderer, NULL, ren->quads.vertices, count * 4, ren->quads.indices, count * 6);
+}
+
+static void renderer_sdl_present(renderer_t* ren)
 {
     SDL_RenderPresent(ren->renderer);
 }
 
-void renderer_draw_text(renderer_t* ren, const char* text, int x, int y, color_t color)
+static void renderer_software_destroy(renderer_t* ren)
 {
-    TTF_Font* font = TTF_OpenFont("Resources/roboto.ttf", FONT_SIZE);
-    if (font == NULL) {
-        fprintf(stderr, "Failed to open font file! %s\n", SDL_GetError());
-        return;
+    framebuffer_destroy(ren->framebuffer);
+    text_font_destroy(ren->font);
+    TTF_Quit();
+}
+
+// The glyph atlas is already in memory, so text is drawn from the font itself.
+static void renderer_software_set_font(renderer_t* ren, text_font_t* font)
+{
+    ren->font = font;
+    if (ren->font == NULL) {
+        fprintf(stderr, "Text rendering is disabled!\n");
     }
-    SDL_Color sdl_color = convert_to_sdl_color(color);
-    SDL_Surface* surface = TTF_RenderText_Blended(font, text, sdl_color);
-    if (surface == NULL) {
-        TTF_CloseFont(font);
-        fprintf(stderr, "Failed to create surface for font! %s\n", SDL_GetError());
-        return;
+}
+
+static void renderer_software_clear(renderer_t* ren, color_t color)
+{
+    framebuffer_clear(ren->framebuffer, framebuffer_color(color));
+}
+
+static void renderer_software_fill_rects(renderer_t* ren, const SDL_Rect* rects, int count, color_t color)
+{
+    Uint32 pixel = framebuffer_color(color);
+    for (int i = 0; i < count; i++) {
+        framebuffer_fill_rect(ren->framebuffer, rects[i].x, rects[i].y, rects[i].w, rects[i].h, pixel);
     }
+}
 
-    SDL_Texture* tex = SDL_CreateTextureFromSurface(ren->renderer, surface);
-    if (tex == NULL) {
-        SDL_FreeSurface(surface);
-        fprintf(stderr, "Failed to create texture from surface! %s\n", SDL_GetError());
+static void renderer_software_draw_text(renderer_t* ren, const char* text, int x, int y, color_t color, int cached)
+{
+    (void)cached;
+    if (ren->font == NULL)
         return;
+    framebuffer_draw_text(ren->framebuffer, ren->font, text, x, y, color);
+}
+
+// The quads are axis aligned, so the first and the last corner make the rect.
+static void renderer_software_draw_quads(renderer_t* ren, int count)
+{
+    const SDL_Vertex* vertex = ren->quads.vertices;
+    for (int i = 0; i < count; i++, vertex += 4) {
+        int x = (int)vertex[0].position.x;
+        int y = (int)vertex[0].position.y;
+        color_t color = { .r = vertex[0].color.r, .g = vertex[0].color.g, .b = vertex[0].color.b, .a = vertex[0].color.a };
+        framebuffer_fill_rect(ren->framebuffer, x, y, (int)vertex[3].position.x - x, (int)vertex[3].position.y - y,
+            framebuffer_color(color));
     }
-    SDL_FreeSurface(surface);
-    TTF_CloseFont(font);
-    SDL_Rect dst;
-    dst.x = x;
-    dst.y = y;
-    SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
-    SDL_RenderCopy(ren->renderer, tex, NULL, &dst);
 }
 
-SDL_Color convert_to_sdl_color(color_t color)
+static void renderer_software_present(renderer_t* ren)
 {
-    SDL_Color sdl_color = { .r = color.r, .g = color.g, .b = color.b, .a = color.a };
-    return sdl_color;
+    if (ren->frame_directory == NULL)
+        return;
+    char filename[FRAME_FILENAME_SIZE];
+    snprintf(filename, sizeof(filename), "%s/frame_%06ld.png", ren->frame_directory, ren->frame);
+    framebuffer_save_png(ren->framebuffer, filename);
 }
@@ -24,20 +24,90 @@
 #ifndef BRICKS_RENDERER_H
 #define BRICKS_RENDERER_H
 
+#include "asset.h"
+#include "framebuffer.h"
+#include "particle.h"
+#include "text.h"
 #include "types.h"
 #include <SDL2/SDL.h>
 
+typedef struct rect_command {
+    SDL_Rect rect;
+    Uint32 color; // packed rgba, doubles as the sort key
+} rect_command_t;
+
+typedef struct rect_batch {
+    rect_command_t *commands;
+    SDL_Rect *rects; // sorted rects handed to SDL_RenderFillRects
+    int count, capacity;
+    int draw_calls; // fill calls issued by the last flush
+} rect_batch_t;
+
+// Quads handed to SDL_RenderGeometry in one call. The indices never change, so they are only
+// written when the batch grows.
+typedef struct quad_batch {
+    SDL_Vertex *vertices;
+    int *indices;
+    int count, capacity; // in quads
+} quad_batch_t;
+
+struct renderer;
+
+// What a renderer draws with. The SDL backend draws through an SDL_Renderer into a window, the
+// software backend into a framebuffer in memory, which needs no display at all.
+typedef struct renderer_backend {
+    const char *name;
+    void (*destroy)(struct renderer *ren);
+    void (*set_font)(struct renderer *ren, text_font_t *font);
+    void (*clear)(struct renderer *ren, color_t color);
+    void (*fill_rects)(struct renderer *ren, const SDL_Rect *rects, int count, color_t color);
+    void (*draw_text)(struct renderer *ren, const char *text, int x, int y, color_t color, int cached);
+    // untextured, axis aligned quads from the renderer's quad batch
+    void (*draw_quads)(struct renderer *ren, int count);
+    void (*present)(struct renderer *ren);
+} renderer_backend_t;
+
+// Code that works with SDL textures directly, like the brick layer and the sprites, only runs when
+// renderer is set; the software backend leaves it NULL.
 typedef struct renderer {
+    const renderer_backend_t *backend;
     SDL_Window *window;
     SDL_Renderer *renderer;
+    text_t *text;
+    framebuffer_t *framebuffer; // the software backend's, along with the font it draws text from
+    text_font_t *font;
+    const char *frame_directory; // the software backend writes every presented frame there, when set
+    long frame; // frames presented
+    rect_batch_t batch;
+    quad_batch_t quads;
 } renderer_t;
 
 renderer_t * renderer_create(const char *title, int width, int height);
+// The two halves of renderer_create, so the font can load on another thread while the window comes up.
+renderer_t *renderer_create_window(const char *title, int width, int height);
+// Draws into memory instead of a window; the directory has to outlive the renderer.
+renderer_t *renderer_create_software(int width, int height, const char *frame_directory);
+// Takes the font from the assets when they have it, from Resources/ otherwise.
+text_font_t *renderer_load_font(const asset_pack_t *assets);
+// Takes the font over; without one, text rendering stays disabled.
+void renderer_set_font(renderer_t *ren, text_font_t *font);
 
 void renderer_destroy(renderer_t *renderer);
 
 void renderer_draw_rect(renderer_t *ren, int x, int y, int width, int height, color_t color);
 void renderer_draw_text(renderer_t *ren, const char *text, int x, int y, color_t color);
+// Like renderer_draw_text, but keeps the rendered string around; meant for HUD text that rarely changes.
+void renderer_draw_static_text(renderer_t *ren, const char *text, int x, int y, color_t color);
+text_stats_t renderer_text_stats(renderer_t *ren);
+// Rect batches are sorted by color on flush and every color is sent with a single fill call.
+// Rects of different colors may therefore be drawn out of order, so only batch rects that don't overlap.
+void renderer_begin_rects(renderer_t *ren);
+void renderer_push_rect(renderer_t *ren, int x, int y, int width, int height, color_t color);
+int renderer_flush_rects(renderer_t *ren);
+void renderer_draw_particles(renderer_t *ren, const particle_pool_t *particles, int offset_y);
+// Makes room for count quads, keeping the ones already there.
+void quad_batch_reserve(quad_batch_t *quads, int count);
+
 void renderer_clear(renderer_t *ren, color_t clear_color);
 void renderer_present(renderer_t *ren);
 
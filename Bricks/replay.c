@@ -0,0 +1,318 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "replay.h"
+#include "level_format.h"
+#include "types.h"
+#include <malloc.h>
+#include <string.h>
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+static int write_run(replay_recorder_t* recorder);
+static int write_varint(FILE* file, uint64_t value);
+static int read_varint(const unsigned char** cursor, const unsigned char* end, uint64_t* value);
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size);
+static uint64_t game_state_hash(const game_t* game);
+
+// Starts recording a game that has not ticked yet. The level and the balls are written right
+// away, the keys follow tick by tick through the buffered file so recording doesn't allocate.
+replay_recorder_t* replay_recorder_create(const char* filename, const game_t* game)
+{
+    if (game->stream != NULL || game->tick != 0) {
+        fprintf(stderr, "Only games of a whole level can be recorded from their start!\n");
+        return NULL;
+    }
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return NULL;
+    }
+
+    replay_recorder_t* recorder = calloc(1, sizeof(replay_recorder_t));
+    recorder->file = file;
+    recorder->filename = filename;
+    replay_header_t* header = &recorder->header;
+    memcpy(header->magic, REPLAY_MAGIC, 4);
+    header->version = REPLAY_VERSION;
+    header->header_size = sizeof(replay_header_t);
+    header->byte_order = LEVEL_BINARY_BYTE_ORDER;
+    header->life_count = game->life_count;
+    header->paddle_x = game->paddle->x;
+    header->paddle_y = game->paddle->y;
+    header->paddle_width = game->paddle->width;
+    header->paddle_height = game->paddle->height;
+    const ball_set_t* balls = game->balls;
+    header->ball_count = balls->count;
+    header->ball_capacity = balls->capacity;
+    header->ball_width = balls->width;
+    header->ball_height = balls->height;
+    header->spawn_x = balls->spawn_x;
+    header->spawn_y = balls->spawn_y;
+    header->spawn_velocity_x = balls->spawn_velocity_x;
+    header->spawn_velocity_y = balls->spawn_velocity_y;
+
+    // the header is written again with the sizes and the final state once the recording ends
+    int written = fwrite(header, sizeof(replay_header_t), 1, file) == 1 && level_write_binary_file(game->level, file);
+    header->level_size = (uint32_t)(ftell(file) - (long)sizeof(replay_header_t));
+    for (int i = 0; i < balls->count && written; i++) {
+        replay_ball_t ball = { balls->x[i], balls->y[i], balls->velocity_x[i], balls->velocity_y[i] };
+        written = fwrite(&ball, sizeof(ball), 1, file) == 1;
+    }
+    if (!written) {
+        fprintf(stderr, "Failed to write file: %s\n", filename);
+        fclose(file);
+        free(recorder);
+        return NULL;
+    }
+    return recorder;
+}
+
+void replay_recorder_tick(replay_recorder_t* recorder, unsigned keys)
+{
+    if (recorder == NULL)
+        return;
+    if (recorder->run > 0 && keys == recorder->keys) {
+        recorder->run++;
+        return;
+    }
+    write_run(recorder);
+    recorder->keys = keys;
+    recorder->run = 1;
+}
+
+// Writes what is left of the recording and closes it, the game is the one after the last tick.
+int replay_recorder_finish(replay_recorder_t* recorder, const game_t* game)
+{
+    if (recorder == NULL)
+        return TRUE;
+    FILE* file = recorder->file;
+    replay_header_t* header = &recorder->header;
+    long input_offset = (long)(sizeof(replay_header_t) + header->level_size + header->ball_count * sizeof(replay_ball_t));
+    write_run(recorder);
+    header->input_size = (uint32_t)(ftell(file) - input_offset);
+    header->tick_count = (uint64_t)game->tick;
+    header->final_hash = game_state_hash(game);
+    int written = !ferror(file) && fseek(file, 0, SEEK_SET) == 0 && fwrite(header, sizeof(replay_header_t), 1, file) == 1;
+    if (fclose(file) != 0 || !written) {
+        fprintf(stderr, "Failed to write file: %s\n", recorder->filename);
+        written = FALSE;
+    }
+    free(recorder);
+    return written;
+}
+
+int replay_probe(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+        return FALSE;
+    char magic[4];
+    int probed = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, REPLAY_MAGIC, 4) == 0;
+    fclose(file);
+    return probed;
+}
+
+replay_t* replay_open(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return NULL;
+    }
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    unsigned char* data = size > 0 ? malloc((size_t)size) : NULL;
+    int read = data != NULL && fseek(file, 0, SEEK_SET) == 0 && fread(data, (size_t)size, 1, file) == 1;
+    fclose(file);
+    if (!read) {
+        fprintf(stderr, "Failed to read file: %s\n", filename);
+        free(data);
+        return NULL;
+    }
+
+    replay_header_t header;
+    if ((size_t)size < sizeof(header)) {
+        fprintf(stderr, "%s: replay is truncated\n", filename);
+        free(data);
+        return NULL;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, REPLAY_MAGIC, 4) != 0 || header.version != REPLAY_VERSION || header.header_size != sizeof(header)
+        || header.byte_order != LEVEL_BINARY_BYTE_ORDER) {
+        fprintf(stderr, "%s: unsupported replay\n", filename);
+        free(data);
+        return NULL;
+    }
+    // replays are passed around as workloads, nothing in them goes into a game unchecked
+    if (header.ball_capacity <= 0 || header.ball_width <= 0 || header.ball_height <= 0 || header.paddle_width <= 0
+        || header.paddle_height <= 0 || header.life_count < 0) {
+        fprintf(stderr, "%s: replay header is corrupt\n", filename);
+        free(data);
+        return NULL;
+    }
+    uint64_t expected = sizeof(header) + (uint64_t)header.level_size + (uint64_t)header.input_size;
+    if (header.ball_count < 0 || header.ball_count > header.ball_capacity
+        || expected + (uint64_t)header.ball_count * sizeof(replay_ball_t) != (uint64_t)size) {
+        fprintf(stderr, "%s: replay is truncated\n", filename);
+        free(data);
+        return NULL;
+    }
+
+    replay_t* replay = calloc(1, sizeof(replay_t));
+    replay->data = data;
+    replay->header = header;
+    replay->input = data + size - header.input_size;
+    replay->input_end = data + size;
+    return replay;
+}
+
+void replay_destroy(replay_t* replay)
+{
+    if (replay == NULL)
+        return;
+    free(replay->data);
+    free(replay);
+}
+
+// Sets up the game as it was when the recording started.
+game_t* replay_create_game(const replay_t* replay)
+{
+    const replay_header_t* header = &replay->header;
+    // a level image that is copied is checked in full, checksum included
+    level_t* level = level_create_from_memory(replay->data + header->header_size, header->level_size, "replay");
+    if (level == NULL)
+        return NULL;
+    game_t* game = game_create(level, header->ball_capacity);
+    game->life_count = header->life_count;
+    game->paddle->x = header->paddle_x;
+    game->paddle->y = header->paddle_y;
+    game->paddle->width = header->paddle_width;
+    game->paddle->height = header->paddle_height;
+    ball_set_t* balls = game->balls;
+    balls->width = header->ball_width;
+    balls->height = header->ball_height;
+    ball_set_spawn_point(balls, header->spawn_x, header->spawn_y, header->spawn_velocity_x, header->spawn_velocity_y);
+    balls->count = 0;
+    const unsigned char* ball_data = replay->data + header->header_size + header->level_size;
+    for (int i = 0; i < header->ball_count; i++) {
+        replay_ball_t ball;
+        memcpy(&ball, ball_data + i * sizeof(ball), sizeof(ball));
+        ball_set_add(balls, ball.x, ball.y, ball.velocity_x, ball.velocity_y);
+    }
+    return game;
+}
+
+// The keys of the next tick, FALSE once all recorded ticks were played.
+int replay_next(replay_t* replay, unsigned* keys)
+{
+    if (replay->tick == replay->header.tick_count)
+        return FALSE;
+    while (replay->run == 0) {
+        uint64_t mask;
+        if (!read_varint(&replay->input, replay->input_end, &mask) || !read_varint(&replay->input, replay->input_end, &replay->run)) {
+            fprintf(stderr, "Replay input ends at tick %llu!\n", (unsigned long long)replay->tick);
+            replay->header.tick_count = replay->tick;
+            return FALSE;
+        }
+        replay->keys = (unsigned)mask;
+    }
+    replay->run--;
+    replay->tick++;
+    *keys = replay->keys;
+    return TRUE;
+}
+
+// Compares the game after playback with the one at the end of the recording.
+int replay_verify(const replay_t* replay, const game_t* game)
+{
+    if ((uint64_t)game->tick != replay->header.tick_count) {
+        fprintf(stderr, "Replay diverged: the game ended after %ld of %llu ticks!\n",
+            game->tick, (unsigned long long)replay->header.tick_count);
+        return FALSE;
+    }
+    if (game_state_hash(game) != replay->header.final_hash) {
+        fprintf(stderr, "Replay diverged: the game state differs after %ld ticks!\n", game->tick);
+        return FALSE;
+    }
+    printf("replay: %ld ticks, same state as recorded\n", game->tick);
+    return TRUE;
+}
+
+static int write_run(replay_recorder_t* recorder)
+{
+    if (recorder->run == 0)
+        return TRUE;
+    return write_varint(recorder->file, recorder->keys) && write_varint(recorder->file, recorder->run);
+}
+
+static int write_varint(FILE* file, uint64_t value)
+{
+    while (value >= 0x80) {
+        if (putc((int)(value & 0x7f) | 0x80, file) == EOF)
+            return FALSE;
+        value >>= 7;
+    }
+    return putc((int)value, file) != EOF;
+}
+
+static int read_varint(const unsigned char** cursor, const unsigned char* end, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+        unsigned char byte = *(*cursor)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t game_state_hash(const game_t* game)
+{
+    const ball_set_t* balls = game->balls;
+    const level_t* level = game->level;
+    uint64_t hash = FNV_OFFSET;
+    hash = hash_bytes(hash, &game->life_count, sizeof(game->life_count));
+    hash = hash_bytes(hash, &game->paddle->x, sizeof(game->paddle->x));
+    hash = hash_bytes(hash, &balls->count, sizeof(balls->count));
+    hash = hash_bytes(hash, balls->x, balls->count * sizeof(float));
+    hash = hash_bytes(hash, balls->y, balls->count * sizeof(float));
+    hash = hash_bytes(hash, balls->velocity_x, balls->count * sizeof(float));
+    hash = hash_bytes(hash, balls->velocity_y, balls->count * sizeof(float));
+    hash = hash_bytes(hash, &level->brick_count, sizeof(level->brick_count));
+    hash = hash_bytes(hash, level->life_count, level->brick_count * sizeof(int));
+    return hash;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_REPLAY_H
+#define BRICKS_REPLAY_H
+
+#include "game.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// A replay file holds the header, the level as a compiled level image, the balls as they were
+// when the recording started and then the keys of every tick as runs of varints: the key mask
+// followed by the number of ticks it was held for.
+#define REPLAY_MAGIC "BRKR"
+#define REPLAY_VERSION 1
+
+typedef struct replay_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t byte_order;
+    uint32_t level_size;
+    uint32_t input_size;
+    int32_t life_count;
+    int32_t paddle_x, paddle_y;
+    int32_t paddle_width, paddle_height;
+    int32_t ball_count, ball_capacity;
+    int32_t ball_width, ball_height;
+    float spawn_x, spawn_y;
+    float spawn_velocity_x, spawn_velocity_y;
+    uint64_t tick_count;
+    uint64_t final_hash; // of the game state after the last tick, to tell whether playback diverged
+} replay_header_t;
+
+typedef struct replay_ball {
+    float x, y;
+    float velocity_x, velocity_y;
+} replay_ball_t;
+
+typedef struct replay_recorder {
+    FILE *file;
+    const char *filename;
+    replay_header_t header;
+    unsigned keys;
+    uint64_t run; // ticks the current keys were held for
+} replay_recorder_t;
+
+typedef struct replay {
+    unsigned char *data;
+    replay_header_t header;
+    const unsigned char *input, *input_end;
+    unsigned keys;
+    uint64_t run; // ticks left for the current keys
+    uint64_t tick;
+} replay_t;
+
+replay_recorder_t *replay_recorder_create(const char *filename, const game_t *game);
+void replay_recorder_tick(replay_recorder_t *recorder, unsigned keys);
+int replay_recorder_finish(replay_recorder_t *recorder, const game_t *game);
+
+int replay_probe(const char *filename);
+replay_t *replay_open(const char *filename);
+void replay_destroy(replay_t *replay);
+game_t *replay_create_game(const replay_t *replay);
+int replay_next(replay_t *replay, unsigned *keys);
+int replay_verify(const replay_t *replay, const game_t *game);
+
+#endif //BRICKS_REPLAY_H
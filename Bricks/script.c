@@ -0,0 +1,95 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "script.h"
+#include "types.h"
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SCRIPT_MAX_LINE 128
+
+script_t* script_create(const char* filename)
+{
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open file: %s\n", filename);
+        return NULL;
+    }
+    script_t* script = calloc(1, sizeof(script_t));
+    int capacity = 0;
+    char line[SCRIPT_MAX_LINE];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        long tick;
+        char input[16];
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line)) {
+            continue;
+        }
+        if (sscanf(line, "%ld %15s", &tick, input) != 2 || (script->count > 0 && tick < script->entries[script->count - 1].tick)) {
+            fprintf(stderr, "%s:%d: expected '<tick> <left|right|none>' with increasing ticks\n", filename, line_number);
+            fclose(file);
+            script_destroy(script);
+            return NULL;
+        }
+        script_entry_t entry = { .tick = tick, .held = TRUE, .key = LEFT };
+        if (strcmp(input, "right") == 0) {
+            entry.key = RIGHT;
+        } else if (strcmp(input, "none") == 0) {
+            entry.held = FALSE;
+        } else if (strcmp(input, "left") != 0) {
+            fprintf(stderr, "%s:%d: unknown input '%s'\n", filename, line_number, input);
+            fclose(file);
+            script_destroy(script);
+            return NULL;
+        }
+        if (script->count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            script->entries = realloc(script->entries, capacity * sizeof(script_entry_t));
+        }
+        script->entries[script->count++] = entry;
+    }
+    fclose(file);
+    return script;
+}
+
+void script_destroy(script_t* script)
+{
+    if (script == NULL)
+        return;
+    free(script->entries);
+    free(script);
+}
+
+int script_input(script_t* script, long tick, enum key* key)
+{
+    while (script->cursor + 1 < script->count && script->entries[script->cursor + 1].tick <= tick) {
+        script->cursor++;
+    }
+    if (script->count == 0 || script->entries[script->cursor].tick > tick) {
+        return FALSE;
+    }
+    *key = script->entries[script->cursor].key;
+    return script->entries[script->cursor].held;
+}
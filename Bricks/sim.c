@@ -0,0 +1,211 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "sim.h"
+#include "collision.h"
+#include "profiler.h"
+#include <math.h>
+#include <stddef.h>
+
+// a ball wedged between bricks gives up the rest of its move after this many bounces
+#define SIM_MAX_IMPACTS 8
+
+static int sim_needs_sweep(level_t* level, const ball_set_t* balls, int index, const paddle_t* paddle);
+static void sim_sweep_walls(const ball_set_t* balls, int index, float dx, float dy, collision_hit_t* hit);
+static void sim_collide_with_paddle(const paddle_t* paddle, ball_set_t* balls, int index);
+
+int sim_tick(level_t* level, ball_set_t* balls, paddle_t* paddle)
+{
+    ball_set_save_positions(balls);
+    sim_move_balls(level, balls, paddle);
+    return sim_check_loose_life(balls);
+}
+
+// Balls that may reach a brick or the paddle during this tick are moved to the end of the set and
+// swept one by one, all others only need the wall checks and are integrated in bulk.
+void sim_move_balls(level_t* level, ball_set_t* balls, const paddle_t* paddle)
+{
+    profile_scope_t scope = profile_begin(PROFILE_BALL_MOVE);
+    int swept_begin = balls->count;
+    for (int i = 0; i < swept_begin;) {
+        if (sim_needs_sweep(level, balls, i, paddle)) {
+            ball_set_swap(balls, i, --swept_begin);
+        } else {
+            i++;
+        }
+    }
+    if (paddle != NULL) {
+        ball_set_integrate(balls, 0, swept_begin, paddle->x, paddle->y, paddle->width, paddle->height);
+    } else {
+        ball_set_integrate(balls, 0, swept_begin, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+    profile_end(scope);
+
+    scope = profile_begin(PROFILE_BRICK_COLLISION);
+    for (int i = swept_begin; i < balls->count; i++) {
+        sim_move_ball(level, balls, i, paddle);
+    }
+    profile_end(scope);
+
+    if (paddle != NULL) {
+        scope = profile_begin(PROFILE_PADDLE_COLLISION);
+        for (int i = swept_begin; i < balls->count; i++) {
+            sim_collide_with_paddle(paddle, balls, i);
+        }
+        profile_end(scope);
+    }
+}
+
+// Moves one ball through the tick and resolves its impacts in the order they happen. Each
+// impact reflects the ball off the face it hit and the rest of the move continues from there,
+// so the ball can't pass through a brick however far it moves per tick.
+void sim_move_ball(level_t* level, ball_set_t* balls, int index, const paddle_t* paddle)
+{
+    float remaining = 1.0f;
+    for (int impact = 0; impact < SIM_MAX_IMPACTS && remaining > 0.0f; impact++) {
+        float x = balls->x[index];
+        float y = balls->y[index];
+        float dx = balls->velocity_x[index] * remaining;
+        float dy = balls->velocity_y[index] * remaining;
+        collision_box_t box = { x, y, balls->width, balls->height };
+        collision_hit_t hit = { .time = 2.0f };
+        collision_hit_t candidate_hit;
+        int hit_brick = -1;
+
+        sim_sweep_walls(balls, index, dx, dy, &hit);
+        if (paddle != NULL) {
+            collision_box_t paddle_box = { paddle->x, paddle->y, paddle->width, paddle->height };
+            if (collision_sweep(&box, dx, dy, &paddle_box, &candidate_hit) && candidate_hit.time < hit.time) {
+                hit = candidate_hit;
+            }
+        }
+        // only look at bricks near the box the ball sweeps during the rest of the move
+        int min_x = (int)(dx < 0 ? x + dx : x) - 1;
+        int min_y = (int)(dy < 0 ? y + dy : y) - 1;
+        int width = (int)fabsf(dx) + balls->width + 2;
+        int height = (int)fabsf(dy) + balls->height + 2;
+        int* candidates;
+        int candidate_count = grid_query(level->grid, min_x, min_y, width, height, &candidates);
+        for (int i = 0; i < candidate_count; i++) {
+            int brick = candidates[i];
+            collision_box_t brick_box = { level->x[brick], level->y[brick], level->width[brick], level->height[brick] };
+            if (collision_sweep(&box, dx, dy, &brick_box, &candidate_hit) && candidate_hit.time < hit.time) {
+                hit = candidate_hit;
+                hit_brick = brick;
+            }
+        }
+
+        if (hit.time > 1.0f) {
+            balls->x[index] = x + dx;
+            balls->y[index] = y + dy;
+            return;
+        }
+        balls->x[index] = x + dx * hit.time;
+        balls->y[index] = y + dy * hit.time;
+        if (hit.normal_x != 0)
+            balls->velocity_x[index] = hit.normal_x * fabsf(balls->velocity_x[index]);
+        if (hit.normal_y != 0)
+            balls->velocity_y[index] = hit.normal_y * fabsf(balls->velocity_y[index]);
+        if (hit_brick >= 0) {
+            level_hit_brick(level, hit_brick);
+            if (level->life_count[hit_brick] <= 0) {
+                level_remove_brick(level, hit_brick);
+            }
+        }
+        remaining *= 1.0f - hit.time;
+    }
+}
+
+// Drops the balls that fell out at the bottom. Losing the last one costs a life and serves a new one.
+int sim_check_loose_life(ball_set_t* balls)
+{
+    if (balls->count == 0)
+        return FALSE;
+    for (int i = 0; i < balls->count;) {
+        if (balls->y[i] + balls->height > balls->top + balls->window_height) {
+            ball_set_remove(balls, i);
+        } else {
+            i++;
+        }
+    }
+    if (balls->count == 0) {
+        ball_set_reset(balls);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static int sim_needs_sweep(level_t* level, const ball_set_t* balls, int index, const paddle_t* paddle)
+{
+    float x = balls->x[index];
+    float y = balls->y[index];
+    float dx = balls->velocity_x[index];
+    float dy = balls->velocity_y[index];
+    int min_x = (int)(dx < 0 ? x + dx : x) - 1;
+    int min_y = (int)(dy < 0 ? y + dy : y) - 1;
+    int max_x = (int)(dx < 0 ? x : x + dx) + balls->width + 1;
+    int max_y = (int)(dy < 0 ? y : y + dy) + balls->height + 1;
+    if (paddle != NULL && max_x >= paddle->x && min_x <= paddle->x + paddle->width && max_y >= paddle->y && min_y <= paddle->y + paddle->height)
+        return TRUE;
+    int* candidates;
+    return grid_query(level->grid, min_x, min_y, max_x - min_x, max_y - min_y, &candidates) > 0;
+}
+
+// The left, right and top edges of the window bounce the ball, the bottom one loses it.
+static void sim_sweep_walls(const ball_set_t* balls, int index, float dx, float dy, collision_hit_t* hit)
+{
+    float x = balls->x[index];
+    float y = balls->y[index];
+    float time;
+    if (dx != 0.0f) {
+        time = dx < 0 ? -x / dx : (balls->window_width - (x + balls->width)) / dx;
+        if (time < 0.0f)
+            time = 0.0f;
+        if (time <= 1.0f && time < hit->time) {
+            hit->time = time;
+            hit->normal_x = dx < 0 ? 1 : -1;
+            hit->normal_y = 0;
+        }
+    }
+    if (dy < 0.0f) {
+        time = (balls->top - y) / dy;
+        if (time < 0.0f)
+            time = 0.0f;
+        if (time <= 1.0f && time < hit->time) {
+            hit->time = time;
+            hit->normal_x = 0;
+            hit->normal_y = 1;
+        }
+    }
+}
+
+// The paddle may have moved into the ball, which the sweep can't see.
+static void sim_collide_with_paddle(const paddle_t* paddle, ball_set_t* balls, int index)
+{
+    float x = balls->x[index];
+    float y = balls->y[index];
+    if (balls->velocity_y[index] > 0.0f && x + balls->width > paddle->x && x < paddle->x + paddle->width
+        && y + balls->height > paddle->y && y < paddle->y + paddle->height) {
+        balls->velocity_y[index] = -balls->velocity_y[index];
+    }
+}
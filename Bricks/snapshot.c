@@ -0,0 +1,374 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "snapshot.h"
+#include "clock.h"
+#include "types.h"
+#include <malloc.h>
+#include <string.h>
+
+enum snapshot_field {
+    SNAPSHOT_TICK_LOW,
+    SNAPSHOT_TICK_HIGH,
+    SNAPSHOT_LIFE_COUNT,
+    SNAPSHOT_PADDLE_X,
+    SNAPSHOT_PADDLE_Y,
+    SNAPSHOT_BALL_COUNT,
+    SNAPSHOT_BRICK_COUNT,
+    SNAPSHOT_HEADER_WORDS
+};
+
+// unchanged words a delta run swallows; a new run would cost two header words anyway
+#define SNAPSHOT_RUN_GAP 2
+#define SNAPSHOT_BLOCK_WORDS 16
+// sections from here on belong to the level
+#define SNAPSHOT_LEVEL_SECTION 6
+
+static int snapshot_sections(const snapshot_ring_t* ring, const game_t* game, void** sections, size_t* sizes);
+static void snapshot_header(const game_t* game, uint32_t* words);
+static void snapshot_read_header(const uint32_t* words, game_t* game);
+static void snapshot_write(const snapshot_ring_t* ring, const game_t* game, uint32_t* words);
+static void snapshot_read(const snapshot_ring_t* ring, const uint32_t* words, game_t* game);
+static uint32_t* snapshot_reserve_delta(snapshot_ring_t* ring, size_t size);
+static void snapshot_drop_oldest(snapshot_ring_t* ring);
+static size_t snapshot_diff(uint32_t* head, size_t offset, const void* section, size_t size, uint32_t* out);
+static void snapshot_apply(snapshot_ring_t* ring, const uint32_t* delta, size_t size, game_t* game);
+
+// Keeps the last tick_count ticks of the game, starting with its state right now. The layout is
+// fixed by the game as it is: levels only lose bricks while they are played, a reloaded level
+// needs a new ring.
+snapshot_ring_t* snapshot_ring_create(const game_t* game, int tick_count)
+{
+    if (game->stream != NULL) {
+        fprintf(stderr, "Streamed levels can't be snapshot!\n");
+        return NULL;
+    }
+    const grid_t* grid = game->level->grid;
+    snapshot_ring_t* ring = calloc(1, sizeof(snapshot_ring_t));
+    ring->ball_capacity = game->balls->capacity;
+    ring->brick_capacity = game->level->brick_count;
+    ring->cell_count = grid->columns * grid->rows;
+    ring->entry_count = grid->cell_start[ring->cell_count];
+    ring->grid = grid;
+
+    void* sections[SNAPSHOT_SECTION_COUNT];
+    size_t sizes[SNAPSHOT_SECTION_COUNT];
+    int count = snapshot_sections(ring, game, sections, sizes);
+    ring->words = SNAPSHOT_HEADER_WORDS;
+    for (int i = 0; i < count; i++) {
+        ring->section_offset[i] = ring->words;
+        ring->words += (sizes[i] + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    }
+    ring->head = calloc(ring->words, sizeof(uint32_t));
+    ring->save = calloc(ring->words, sizeof(uint32_t));
+
+    ring->capacity = tick_count > 0 ? tick_count : 1;
+    ring->deltas = calloc((size_t)ring->capacity, sizeof(snapshot_delta_t));
+    // room for at least two deltas of the worst kind, where every word changed
+    ring->pool_size = SNAPSHOT_DELTA_POOL_SIZE;
+    if (ring->pool_size < 2 * (ring->words + 2 * SNAPSHOT_SECTION_COUNT + 2) * sizeof(uint32_t)) {
+        ring->pool_size = 2 * (ring->words + 2 * SNAPSHOT_SECTION_COUNT + 2) * sizeof(uint32_t);
+    }
+    ring->pool = malloc(ring->pool_size);
+
+    snapshot_write(ring, game, ring->head);
+    ring->level_revision = game->level->revision;
+    return ring;
+}
+
+void snapshot_ring_destroy(snapshot_ring_t* ring)
+{
+    if (ring == NULL)
+        return;
+    free(ring->head);
+    free(ring->save);
+    free(ring->deltas);
+    free(ring->pool);
+    free(ring);
+}
+
+// Takes the game after a tick. The words that changed are moved from the head into a new delta
+// and replaced with the game's.
+void snapshot_ring_capture(snapshot_ring_t* ring, const game_t* game)
+{
+    if (ring == NULL || game->level->grid != ring->grid)
+        return;
+    unsigned long long start = clock_nanoseconds();
+    uint32_t* delta = snapshot_reserve_delta(ring, (ring->words + 2 * SNAPSHOT_SECTION_COUNT + 2) * sizeof(uint32_t));
+    uint32_t header[SNAPSHOT_HEADER_WORDS];
+    snapshot_header(game, header);
+    size_t used = snapshot_diff(ring->head, 0, header, sizeof(header), delta);
+
+    void* sections[SNAPSHOT_SECTION_COUNT];
+    size_t sizes[SNAPSHOT_SECTION_COUNT];
+    int count = snapshot_sections(ring, game, sections, sizes);
+    // the balls move every tick, the bricks only change when one is hit
+    int level_changed = game->level->revision != ring->level_revision;
+    for (int i = 0; i < count; i++) {
+        if (i < SNAPSHOT_LEVEL_SECTION || level_changed) {
+            used += snapshot_diff(ring->head, ring->section_offset[i], sections[i], sizes[i], delta + used);
+        }
+    }
+    ring->level_revision = game->level->revision;
+    ring->deltas[(ring->first + ring->count - 1) % ring->capacity].size = used * sizeof(uint32_t);
+
+    unsigned long long elapsed = clock_nanoseconds() - start;
+    ring->stats.captures++;
+    ring->stats.capture_ns += elapsed;
+    ring->stats.delta_bytes += used * sizeof(uint32_t);
+    if (elapsed > ring->stats.max_capture_ns) {
+        ring->stats.max_capture_ns = elapsed;
+    }
+}
+
+// Steps the game back by one tick, FALSE once there is no older snapshot.
+int snapshot_ring_rewind(snapshot_ring_t* ring, game_t* game)
+{
+    if (ring == NULL || ring->count == 0 || game->level->grid != ring->grid)
+        return FALSE;
+    const snapshot_delta_t* delta = &ring->deltas[(ring->first + ring->count - 1) % ring->capacity];
+    snapshot_apply(ring, (const uint32_t*)(ring->pool + delta->offset), delta->size, game);
+    ring->count--;
+    ring->level_revision = game->level->revision;
+    return TRUE;
+}
+
+void snapshot_ring_save(snapshot_ring_t* ring)
+{
+    if (ring == NULL)
+        return;
+    memcpy(ring->save, ring->head, ring->words * sizeof(uint32_t));
+    ring->has_save = TRUE;
+}
+
+// Puts the game back to the quick save. The ticks in between are gone, so is the way back.
+int snapshot_ring_load(snapshot_ring_t* ring, game_t* game)
+{
+    if (ring == NULL || !ring->has_save || game->level->grid != ring->grid)
+        return FALSE;
+    memcpy(ring->head, ring->save, ring->words * sizeof(uint32_t));
+    ring->first = 0;
+    ring->count = 0;
+    snapshot_read(ring, ring->head, game);
+    ring->level_revision = game->level->revision;
+    return TRUE;
+}
+
+size_t snapshot_ring_snapshot_size(const snapshot_ring_t* ring)
+{
+    return ring->words * sizeof(uint32_t);
+}
+
+// The arrays that make up a snapshot after its header, in the order they are stored.
+static int snapshot_sections(const snapshot_ring_t* ring, const game_t* game, void** sections, size_t* sizes)
+{
+    const ball_set_t* balls = game->balls;
+    const level_t* level = game->level;
+    const grid_t* grid = level->grid;
+    size_t floats = sizeof(float) * ring->ball_capacity;
+    size_t ints = sizeof(int) * ring->brick_capacity;
+    void* pointers[SNAPSHOT_SECTION_COUNT] = {
+        balls->x, balls->y, balls->previous_x, balls->previous_y, balls->velocity_x, balls->velocity_y,
+        level->x, level->y, level->width, level->height, level->life_count, level->color_index,
+        grid->cell_count, grid->entries
+    };
+    const size_t bytes[SNAPSHOT_SECTION_COUNT] = {
+        floats, floats, floats, floats, floats, floats,
+        ints, ints, ints, ints, ints, (size_t)ring->brick_capacity,
+        sizeof(int) * ring->cell_count, sizeof(int) * ring->entry_count
+    };
+    memcpy(sections, pointers, sizeof(pointers));
+    memcpy(sizes, bytes, sizeof(bytes));
+    return SNAPSHOT_SECTION_COUNT;
+}
+
+static void snapshot_header(const game_t* game, uint32_t* words)
+{
+    words[SNAPSHOT_TICK_LOW] = (uint32_t)((unsigned long long)game->tick & 0xffffffffu);
+    words[SNAPSHOT_TICK_HIGH] = (uint32_t)((unsigned long long)game->tick >> 32);
+    words[SNAPSHOT_LIFE_COUNT] = (uint32_t)game->life_count;
+    words[SNAPSHOT_PADDLE_X] = (uint32_t)game->paddle->x;
+    words[SNAPSHOT_PADDLE_Y] = (uint32_t)game->paddle->y;
+    words[SNAPSHOT_BALL_COUNT] = (uint32_t)game->balls->count;
+    words[SNAPSHOT_BRICK_COUNT] = (uint32_t)game->level->brick_count;
+}
+
+static void snapshot_read_header(const uint32_t* words, game_t* game)
+{
+    game->tick = (long)((unsigned long long)words[SNAPSHOT_TICK_HIGH] << 32 | words[SNAPSHOT_TICK_LOW]);
+    game->life_count = (int)words[SNAPSHOT_LIFE_COUNT];
+    game->paddle->x = (int)words[SNAPSHOT_PADDLE_X];
+    game->paddle->y = (int)words[SNAPSHOT_PADDLE_Y];
+    game->balls->count = (int)words[SNAPSHOT_BALL_COUNT];
+    game->level->brick_count = (int)words[SNAPSHOT_BRICK_COUNT];
+}
+
+static void snapshot_write(const snapshot_ring_t* ring, const game_t* game, uint32_t* words)
+{
+    snapshot_header(game, words);
+    void* sections[SNAPSHOT_SECTION_COUNT];
+    size_t sizes[SNAPSHOT_SECTION_COUNT];
+    int count = snapshot_sections(ring, game, sections, sizes);
+    for (int i = 0; i < count; i++) {
+        memcpy(words + ring->section_offset[i], sections[i], sizes[i]);
+    }
+}
+
+static void snapshot_read(const snapshot_ring_t* ring, const uint32_t* words, game_t* game)
+{
+    snapshot_read_header(words, game);
+    void* sections[SNAPSHOT_SECTION_COUNT];
+    size_t sizes[SNAPSHOT_SECTION_COUNT];
+    int count = snapshot_sections(ring, game, sections, sizes);
+    for (int i = 0; i < count; i++) {
+        memcpy(sections[i], words + ring->section_offset[i], sizes[i]);
+    }
+    // bricks may have come back anywhere
+    game->level->dirty_all = TRUE;
+    game->level->revision++;
+}
+
+// Makes room for a delta of up to size bytes after the newest one and adds it to the ring.
+// Deltas are laid out one after the other in the pool and wrap around at its end, overwriting
+// the oldest ones.
+static uint32_t* snapshot_reserve_delta(snapshot_ring_t* ring, size_t size)
+{
+    if (ring->count == ring->capacity) {
+        snapshot_drop_oldest(ring);
+    }
+    size_t offset = 0;
+    if (ring->count > 0) {
+        const snapshot_delta_t* newest = &ring->deltas[(ring->first + ring->count - 1) % ring->capacity];
+        offset = newest->offset + newest->size;
+        if (offset + size > ring->pool_size) {
+            // the end of the pool is given up, together with the older deltas still lying there
+            while (ring->count > 0 && ring->deltas[ring->first].offset >= offset) {
+                snapshot_drop_oldest(ring);
+            }
+            offset = 0;
+        }
+    }
+    while (ring->count > 0) {
+        const snapshot_delta_t* oldest = &ring->deltas[ring->first];
+        if (oldest->offset >= offset + size || oldest->offset + oldest->size <= offset)
+            break;
+        snapshot_drop_oldest(ring);
+    }
+    snapshot_delta_t* delta = &ring->deltas[(ring->first + ring->count) % ring->capacity];
+    delta->offset = offset;
+    delta->size = 0;
+    ring->count++;
+    return (uint32_t*)(ring->pool + offset);
+}
+
+static void snapshot_drop_oldest(snapshot_ring_t* ring)
+{
+    ring->first = (ring->first + 1) % ring->capacity;
+    ring->count--;
+}
+
+// Compares a section of the game with its words in the head, which start at offset. Where they
+// differ the old words go to out as runs of start, length and words, and the head takes the new
+// ones. Returns the words written, never more than two over the section's size.
+static size_t snapshot_diff(uint32_t* head, size_t offset, const void* section, size_t size, uint32_t* out)
+{
+    const unsigned char* bytes = section;
+    uint32_t* words = head + offset;
+    size_t count = size / sizeof(uint32_t);
+    size_t used = 0;
+    size_t i = 0;
+    while (i < count) {
+        if (i % SNAPSHOT_BLOCK_WORDS == 0 && count - i >= SNAPSHOT_BLOCK_WORDS
+            && memcmp(words + i, bytes + i * sizeof(uint32_t), SNAPSHOT_BLOCK_WORDS * sizeof(uint32_t)) == 0) {
+            i += SNAPSHOT_BLOCK_WORDS;
+            continue;
+        }
+        if (memcmp(words + i, bytes + i * sizeof(uint32_t), sizeof(uint32_t)) == 0) {
+            i++;
+            continue;
+        }
+        size_t end = i + 1;
+        for (size_t j = end; j < count && j <= end + SNAPSHOT_RUN_GAP; j++) {
+            if (memcmp(words + j, bytes + j * sizeof(uint32_t), sizeof(uint32_t)) != 0) {
+                end = j + 1;
+            }
+        }
+        out[used++] = (uint32_t)(offset + i);
+        out[used++] = (uint32_t)(end - i);
+        memcpy(out + used, words + i, (end - i) * sizeof(uint32_t));
+        memcpy(words + i, bytes + i * sizeof(uint32_t), (end - i) * sizeof(uint32_t));
+        used += end - i;
+        i = end;
+    }
+    // the bytes past the last whole word are kept zero padded
+    if (size % sizeof(uint32_t) != 0) {
+        uint32_t tail = 0;
+        memcpy(&tail, bytes + count * sizeof(uint32_t), size % sizeof(uint32_t));
+        if (tail != words[count]) {
+            out[used++] = (uint32_t)(offset + count);
+            out[used++] = 1;
+            out[used++] = words[count];
+            words[count] = tail;
+        }
+    }
+    return used;
+}
+
+// Puts the old words of a delta back into the head and into the game. A run never spans sections.
+static void snapshot_apply(snapshot_ring_t* ring, const uint32_t* delta, size_t size, game_t* game)
+{
+    void* sections[SNAPSHOT_SECTION_COUNT];
+    size_t sizes[SNAPSHOT_SECTION_COUNT];
+    snapshot_sections(ring, game, sections, sizes);
+    int brick_count = game->level->brick_count;
+    int level_restored = FALSE;
+    const uint32_t* end = delta + size / sizeof(uint32_t);
+    while (delta < end) {
+        uint32_t start = delta[0];
+        uint32_t length = delta[1];
+        memcpy(ring->head + start, delta + 2, length * sizeof(uint32_t));
+        delta += 2 + length;
+        if (start < SNAPSHOT_HEADER_WORDS) {
+            snapshot_read_header(ring->head, game);
+            continue;
+        }
+        int section = SNAPSHOT_SECTION_COUNT - 1;
+        while (ring->section_offset[section] > start) {
+            section--;
+        }
+        size_t byte = (start - ring->section_offset[section]) * sizeof(uint32_t);
+        size_t bytes = length * sizeof(uint32_t);
+        if (byte + bytes > sizes[section]) {
+            bytes = sizes[section] - byte;
+        }
+        memcpy((unsigned char*)sections[section] + byte, ring->head + start, bytes);
+        if (section >= SNAPSHOT_LEVEL_SECTION) {
+            level_restored = TRUE;
+        }
+    }
+    // views that cache the bricks go by the revision, the brick count comes back with the header
+    if (level_restored || game->level->brick_count != brick_count) {
+        game->level->dirty_all = TRUE;
+        game->level->revision++;
+    }
+}
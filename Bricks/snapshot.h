@@ -0,0 +1,78 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_SNAPSHOT_H
+#define BRICKS_SNAPSHOT_H
+
+#include "game.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNAPSHOT_RING_SECONDS 10
+#define SNAPSHOT_DELTA_POOL_SIZE (8 * 1024 * 1024)
+#define SNAPSHOT_SECTION_COUNT 14
+
+// A snapshot is the game flattened into words: the counters, the ball arrays, the brick columns
+// and the grid cells, at fixed offsets. The ring keeps the latest snapshot in full and, for every
+// tick before it, a delta with the words that tick changed, so stepping back copies only those.
+// The bricks are only compared when the level's revision moved.
+typedef struct snapshot_delta {
+    size_t offset; // into the pool
+    size_t size;
+} snapshot_delta_t;
+
+typedef struct snapshot_stats {
+    unsigned long long captures;
+    unsigned long long capture_ns, max_capture_ns;
+    unsigned long long delta_bytes;
+} snapshot_stats_t;
+
+typedef struct snapshot_ring {
+    // the layout of the game the snapshots were taken of
+    int ball_capacity;
+    int brick_capacity;
+    int cell_count, entry_count;
+    const grid_t *grid;
+    size_t section_offset[SNAPSHOT_SECTION_COUNT]; // in words
+    size_t words; // of one snapshot
+    uint32_t *head; // the latest snapshot
+    unsigned long level_revision; // of the bricks in the head
+    uint32_t *save; // the quick save
+    short has_head, has_save;
+    snapshot_delta_t *deltas; // oldest first, starting at first
+    int capacity, first, count;
+    unsigned char *pool;
+    size_t pool_size;
+    snapshot_stats_t stats;
+} snapshot_ring_t;
+
+snapshot_ring_t *snapshot_ring_create(const game_t *game, int tick_count);
+void snapshot_ring_destroy(snapshot_ring_t *ring);
+
+void snapshot_ring_capture(snapshot_ring_t *ring, const game_t *game);
+int snapshot_ring_rewind(snapshot_ring_t *ring, game_t *game);
+void snapshot_ring_save(snapshot_ring_t *ring);
+int snapshot_ring_load(snapshot_ring_t *ring, game_t *game);
+size_t snapshot_ring_snapshot_size(const snapshot_ring_t *ring);
+
+#endif //BRICKS_SNAPSHOT_H
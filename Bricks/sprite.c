@@ -0,0 +1,194 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "sprite.h"
+#include "types.h"
+#include <SDL2/SDL_image.h>
+#include <malloc.h>
+#include <stdio.h>
+
+#define ATLAS_ASSET "atlas.png"
+#define ATLAS_FILENAME "Resources/" ATLAS_ASSET
+
+// in pixels of the atlas image
+static const SDL_Rect FRAME_RECTS[SPRITE_FRAME_COUNT] = {
+    { 0, 0, 48, 16 },
+    { 0, 16, 48, 16 },
+    { 0, 32, 48, 16 },
+    { 48, 0, 64, 16 },
+    { 48, 16, 16, 16 },
+};
+
+static void sprite_write_quad(SDL_Vertex* vertex, const sprite_atlas_t* atlas, enum sprite_frame frame, float x, float y,
+    float width, float height, color_t color);
+
+sprite_atlas_t* sprite_atlas_create(renderer_t* ren, const asset_pack_t* assets)
+{
+    // the software backend draws rects only
+    if (ren->renderer == NULL)
+        return NULL;
+    if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
+        fprintf(stderr, "Failed to initialize SDL_image: %s\n", IMG_GetError());
+        return NULL;
+    }
+    const void* data;
+    size_t size;
+    SDL_Surface* surface;
+    if (asset_find(assets, ATLAS_ASSET, &data, &size)) {
+        surface = IMG_Load_RW(SDL_RWFromConstMem(data, (int)size), 1);
+    } else {
+        surface = IMG_Load(ATLAS_FILENAME);
+    }
+    if (surface == NULL) {
+        fprintf(stderr, "Failed to load the sprite atlas: %s\n", IMG_GetError());
+        IMG_Quit();
+        return NULL;
+    }
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(ren->renderer, surface);
+    int width = surface->w;
+    int height = surface->h;
+    SDL_FreeSurface(surface);
+    if (texture == NULL) {
+        fprintf(stderr, "Failed to create the sprite atlas texture!\n");
+        IMG_Quit();
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    sprite_atlas_t* atlas = malloc(sizeof(sprite_atlas_t));
+    atlas->texture = texture;
+    for (int frame = 0; frame < SPRITE_FRAME_COUNT; frame++) {
+        const SDL_Rect* rect = &FRAME_RECTS[frame];
+        atlas->frames[frame][0] = (SDL_FPoint) { (float)rect->x / width, (float)rect->y / height };
+        atlas->frames[frame][1] = (SDL_FPoint) { (float)(rect->x + rect->w) / width, (float)(rect->y + rect->h) / height };
+    }
+    return atlas;
+}
+
+void sprite_atlas_destroy(sprite_atlas_t* atlas)
+{
+    if (atlas == NULL)
+        return;
+    SDL_DestroyTexture(atlas->texture);
+    IMG_Quit();
+    free(atlas);
+}
+
+enum sprite_frame sprite_brick_frame(int life_count)
+{
+    if (life_count >= 3)
+        return SPRITE_BRICK;
+    return life_count == 2 ? SPRITE_BRICK_CRACKED : SPRITE_BRICK_BROKEN;
+}
+
+void sprite_begin(renderer_t* ren)
+{
+    ren->quads.count = 0;
+}
+
+void sprite_push(renderer_t* ren, const sprite_atlas_t* atlas, enum sprite_frame frame, float x, float y, float width,
+    float height, color_t color)
+{
+    quad_batch_t* quads = &ren->quads;
+    quad_batch_reserve(quads, quads->count + 1);
+    sprite_write_quad(quads->vertices + quads->count * 4, atlas, frame, x, y, width, height, color);
+    quads->count++;
+}
+
+void sprite_flush(renderer_t* ren, const sprite_atlas_t* atlas)
+{
+    quad_batch_t* quads = &ren->quads;
+    if (quads->count > 0) {
+        SDL_RenderGeometry(ren->renderer, atlas->texture, quads->vertices, quads->count * 4, quads->indices, quads->count * 6);
+    }
+    quads->count = 0;
+}
+
+sprite_field_t* sprite_field_create(void)
+{
+    return calloc(1, sizeof(sprite_field_t));
+}
+
+void sprite_field_destroy(sprite_field_t* field)
+{
+    if (field == NULL)
+        return;
+    free(field->quads.vertices);
+    free(field->quads.indices);
+    free(field->bricks);
+    free(field);
+}
+
+void sprite_field_update(sprite_field_t* field, const sprite_atlas_t* atlas, const level_t* level)
+{
+    field->rewritten = 0;
+    if (field->valid && field->revision == level->revision)
+        return;
+    quad_batch_t* quads = &field->quads;
+    int capacity = quads->capacity;
+    quad_batch_reserve(quads, level->brick_count);
+    if (quads->capacity != capacity) {
+        field->bricks = realloc(field->bricks, sizeof(sprite_brick_t) * quads->capacity);
+    }
+    for (int i = 0; i < level->brick_count; i++) {
+        sprite_brick_t* brick = &field->bricks[i];
+        // removing a brick moves the last one into its slot, so a quad past the old count is always new
+        if (field->valid && i < quads->count && brick->x == level->x[i] && brick->y == level->y[i] && brick->width == level->width[i]
+            && brick->height == level->height[i] && brick->life_count == level->life_count[i]
+            && brick->color_index == level->color_index[i])
+            continue;
+        brick->x = level->x[i];
+        brick->y = level->y[i];
+        brick->width = level->width[i];
+        brick->height = level->height[i];
+        brick->life_count = level->life_count[i];
+        brick->color_index = level->color_index[i];
+        sprite_write_quad(quads->vertices + i * 4, atlas, sprite_brick_frame(brick->life_count), (float)brick->x, (float)brick->y,
+            (float)brick->width, (float)brick->height, level_brick_color(level, i));
+        field->rewritten++;
+    }
+    quads->count = level->brick_count;
+    field->revision = level->revision;
+    field->valid = TRUE;
+}
+
+void sprite_field_draw(sprite_field_t* field, const sprite_atlas_t* atlas, renderer_t* ren, const level_t* level)
+{
+    sprite_field_update(field, atlas, level);
+    quad_batch_t* quads = &field->quads;
+    if (quads->count > 0) {
+        SDL_RenderGeometry(ren->renderer, atlas->texture, quads->vertices, quads->count * 4, quads->indices, quads->count * 6);
+    }
+}
+
+static void sprite_write_quad(SDL_Vertex* vertex, const sprite_atlas_t* atlas, enum sprite_frame frame, float x, float y,
+    float width, float height, color_t color)
+{
+    // the palette leaves alpha at 0, the sprites bring their own
+    SDL_Color tint = { (Uint8)color.r, (Uint8)color.g, (Uint8)color.b, 255 };
+    const SDL_FPoint* uv = atlas->frames[frame];
+    vertex[0] = (SDL_Vertex) { { x, y }, tint, { uv[0].x, uv[0].y } };
+    vertex[1] = (SDL_Vertex) { { x + width, y }, tint, { uv[1].x, uv[0].y } };
+    vertex[2] = (SDL_Vertex) { { x, y + height }, tint, { uv[0].x, uv[1].y } };
+    vertex[3] = (SDL_Vertex) { { x + width, y + height }, tint, { uv[1].x, uv[1].y } };
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_SPRITE_H
+#define BRICKS_SPRITE_H
+
+#include "asset.h"
+#include "level.h"
+#include "renderer.h"
+#include <SDL2/SDL.h>
+
+// Frames of Resources/atlas.png. The sprites are grey, the vertex color tints them.
+enum sprite_frame {
+    SPRITE_BRICK, SPRITE_BRICK_CRACKED, SPRITE_BRICK_BROKEN, SPRITE_PADDLE, SPRITE_BALL, SPRITE_FRAME_COUNT
+};
+
+typedef struct sprite_atlas {
+    SDL_Texture *texture;
+    SDL_FPoint frames[SPRITE_FRAME_COUNT][2]; // top left and bottom right texture coordinates
+} sprite_atlas_t;
+
+// What a brick's quad was last written from.
+typedef struct sprite_brick {
+    int x, y;
+    int width, height;
+    int life_count;
+    unsigned char color_index;
+} sprite_brick_t;
+
+// The whole brick field as one vertex array. An update only rewrites the quads of bricks that
+// changed since the last one, and none at all when the level's revision didn't move.
+typedef struct sprite_field {
+    quad_batch_t quads;
+    sprite_brick_t *bricks;
+    unsigned long revision;
+    short valid;
+    int rewritten; // quads written by the last update
+} sprite_field_t;
+
+// Takes the atlas from the assets when they have it, from Resources/ otherwise, and returns NULL
+// when it can't be loaded or the renderer has no textures.
+sprite_atlas_t *sprite_atlas_create(renderer_t *ren, const asset_pack_t *assets);
+void sprite_atlas_destroy(sprite_atlas_t *atlas);
+// A brick's frame goes from whole to broken as it runs out of lives.
+enum sprite_frame sprite_brick_frame(int life_count);
+
+// Sprites are queued like rects and drawn together in one geometry call by sprite_flush.
+void sprite_begin(renderer_t *ren);
+void sprite_push(renderer_t *ren, const sprite_atlas_t *atlas, enum sprite_frame frame, float x, float y, float width,
+    float height, color_t color);
+void sprite_flush(renderer_t *ren, const sprite_atlas_t *atlas);
+
+sprite_field_t *sprite_field_create(void);
+void sprite_field_destroy(sprite_field_t *field);
+void sprite_field_update(sprite_field_t *field, const sprite_atlas_t *atlas, const level_t *level);
+void sprite_field_draw(sprite_field_t *field, const sprite_atlas_t *atlas, renderer_t *ren, const level_t *level);
+
+#endif //BRICKS_SPRITE_H
@@ -0,0 +1,92 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "startup.h"
+#include "clock.h"
+#include "renderer.h"
+#include "types.h"
+#include <stdio.h>
+
+static void* startup_load(void* data);
+
+void startup_begin(startup_t* startup, const asset_pack_t* assets, const char* level_filename, int window_width, int window_height, int load_font, int trace)
+{
+    startup->level_filename = level_filename;
+    startup->assets = assets;
+    startup->level_packed = FALSE;
+    startup->window_width = window_width;
+    startup->window_height = window_height;
+    startup->load_font = (short)load_font;
+    startup->trace = (short)trace;
+    startup->start_ns = clock_nanoseconds();
+    startup->level = NULL;
+    startup->stream = NULL;
+    startup->replay = NULL;
+    startup->font = NULL;
+    if (pthread_create(&startup->thread, NULL, startup_load, startup) != 0) {
+        // loading in place is slower, but still gets the game going
+        startup_load(startup);
+        startup->thread = pthread_self();
+    }
+}
+
+void startup_finish(startup_t* startup)
+{
+    if (!pthread_equal(startup->thread, pthread_self())) {
+        pthread_join(startup->thread, NULL);
+    }
+    startup_stage(startup, "loading done");
+}
+
+void startup_stage(const startup_t* startup, const char* stage)
+{
+    if (startup->trace) {
+        printf("startup: %8.3f ms %s\n", (clock_nanoseconds() - startup->start_ns) / 1e6, stage);
+        fflush(stdout);
+    }
+}
+
+static void* startup_load(void* data)
+{
+    startup_t* startup = data;
+    const void* asset;
+    size_t asset_size;
+    if (startup->level_filename == NULL) {
+        startup->level = level_create_random_level(startup->window_width, startup->window_height);
+    } else if (asset_find(startup->assets, startup->level_filename, &asset, &asset_size)) {
+        startup->level = level_create_from_memory(asset, asset_size, startup->level_filename);
+        startup->level_packed = TRUE;
+    } else if (replay_probe(startup->level_filename)) {
+        startup->replay = replay_open(startup->level_filename);
+    } else if (level_stream_probe(startup->level_filename)) {
+        startup->stream = level_stream_open(startup->level_filename);
+    } else {
+        startup->level = level_create(startup->level_filename);
+    }
+    startup_stage(startup, "level parsed");
+    if (startup->load_font) {
+        startup->font = renderer_load_font(startup->assets);
+        startup_stage(startup, "font loaded");
+    }
+    return NULL;
+}
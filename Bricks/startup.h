@@ -0,0 +1,57 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_STARTUP_H
+#define BRICKS_STARTUP_H
+
+#include "asset.h"
+#include "level.h"
+#include "level_stream.h"
+#include "replay.h"
+#include "text.h"
+#include <pthread.h>
+
+// Loads the level and the font on a worker thread, so the main thread can bring up SDL, the
+// window and the renderer in the meantime. Stages are timed from startup_begin.
+typedef struct startup {
+    const char *level_filename; // NULL for a random level, may also name a replay
+    const asset_pack_t *assets; // may be NULL
+    int window_width, window_height;
+    short load_font;
+    short trace; // print every stage as it finishes
+    unsigned long long start_ns;
+    pthread_t thread;
+    level_t *level;
+    level_stream_t *stream; // set instead of the level for streamed levels
+    replay_t *replay; // set instead of the level for replays, which bring their own
+    short level_packed; // the level came out of the assets rather than from a file
+    text_font_t *font;
+} startup_t;
+
+// Levels named like an asset are taken from the assets, all others are read from disk.
+void startup_begin(startup_t *startup, const asset_pack_t *assets, const char *level_filename, int window_width, int window_height, int load_font, int trace);
+// Waits for the worker; afterwards the level and the font belong to the caller.
+void startup_finish(startup_t *startup);
+void startup_stage(const startup_t *startup, const char *stage);
+
+#endif //BRICKS_STARTUP_H
@@ -0,0 +1,236 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "text.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const SDL_Color GLYPH_COLOR = { .r = 255, .g = 255, .b = 255, .a = 255 };
+
+static void text_font_rasterize(text_font_t* font, int index);
+static glyph_t* text_glyph(text_t* text, char c);
+
+text_font_t* text_font_load(const char* font_filename, int font_size)
+{
+    SDL_RWops* rw = SDL_RWFromFile(font_filename, "rb");
+    if (rw == NULL) {
+        fprintf(stderr, "Failed to open font file! %s\n", SDL_GetError());
+        return NULL;
+    }
+    return text_font_load_rw(rw, font_size);
+}
+
+text_font_t* text_font_load_rw(SDL_RWops* rw, int font_size)
+{
+    TTF_Font* ttf_font = TTF_OpenFontRW(rw, 1, font_size);
+    if (ttf_font == NULL) {
+        fprintf(stderr, "Failed to open font file! %s\n", SDL_GetError());
+        return NULL;
+    }
+
+    text_font_t* font = calloc(1, sizeof(text_font_t));
+    font->font = ttf_font;
+    font->cell_height = TTF_FontHeight(ttf_font);
+    // glyphs can overhang their advance, so give every atlas cell some slack
+    font->cell_width = font->cell_height * 2;
+    int rows = (TEXT_GLYPH_COUNT + TEXT_ATLAS_COLUMNS - 1) / TEXT_ATLAS_COLUMNS;
+    font->atlas_width = TEXT_ATLAS_COLUMNS * font->cell_width;
+    font->atlas_height = rows * font->cell_height;
+    font->pixels = calloc((size_t)font->atlas_width * font->atlas_height, sizeof(Uint32));
+    for (int i = 0; i < TEXT_GLYPH_COUNT; i++) {
+        text_font_rasterize(font, i);
+    }
+    return font;
+}
+
+void text_font_destroy(text_font_t* font)
+{
+    if (font == NULL)
+        return;
+    TTF_CloseFont(font->font);
+    free(font->pixels);
+    free(font);
+}
+
+text_t* text_create(SDL_Renderer* renderer, const char* font_filename, int font_size)
+{
+    return text_create_from_font(renderer, text_font_load(font_filename, font_size));
+}
+
+text_t* text_create_from_font(SDL_Renderer* renderer, text_font_t* font)
+{
+    if (font == NULL)
+        return NULL;
+    SDL_Texture* atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, font->atlas_width, font->atlas_height);
+    if (atlas == NULL) {
+        fprintf(stderr, "Failed to create glyph atlas! %s\n", SDL_GetError());
+        text_font_destroy(font);
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    SDL_UpdateTexture(atlas, NULL, font->pixels, font->atlas_width * (int)sizeof(Uint32));
+
+    text_t* text = calloc(1, sizeof(text_t));
+    text->font = font->font;
+    text->atlas = atlas;
+    text->cell_width = font->cell_width;
+    text->cell_height = font->cell_height;
+    memcpy(text->glyphs, font->glyphs, sizeof(text->glyphs));
+    text->stats.atlas_uploads = 1;
+    free(font->pixels);
+    free(font);
+    return text;
+}
+
+void text_destroy(text_t* text)
+{
+    if (text == NULL)
+        return;
+    for (size_t i = 0; i < TEXT_CACHE_SIZE; i++) {
+        if (text->cache[i].texture != NULL) {
+            SDL_DestroyTexture(text->cache[i].texture);
+        }
+    }
+    SDL_DestroyTexture(text->atlas);
+    TTF_CloseFont(text->font);
+    free(text);
+}
+
+void text_draw(text_t* text, SDL_Renderer* renderer, const char* str, int x, int y, color_t color)
+{
+    SDL_SetTextureColorMod(text->atlas, color.r, color.g, color.b);
+    int pen_x = x;
+    Uint16 previous = 0;
+    for (const char* c = str; *c != '\0'; c++) {
+        glyph_t* glyph = text_glyph(text, *c);
+        Uint16 current = (Uint16)(TEXT_FIRST_GLYPH + (glyph - text->glyphs));
+        if (previous != 0) {
+            pen_x += TTF_GetFontKerningSizeGlyphs(text->font, previous, current);
+        }
+        if (glyph->atlas_rect.w > 0 && glyph->atlas_rect.h > 0) {
+            SDL_Rect dst = { .x = pen_x, .y = y, .w = glyph->atlas_rect.w, .h = glyph->atlas_rect.h };
+            SDL_RenderCopy(renderer, text->atlas, &glyph->atlas_rect, &dst);
+        }
+        pen_x += glyph->advance;
+        previous = current;
+    }
+}
+
+void text_draw_cached(text_t* text, SDL_Renderer* renderer, const char* str, int x, int y, color_t color)
+{
+    if (strlen(str) >= TEXT_CACHE_MAX_LENGTH) {
+        text_draw(text, renderer, str, x, y, color);
+        return;
+    }
+
+    text->clock++;
+    text_cache_entry_t* entry = NULL;
+    text_cache_entry_t* victim = &text->cache[0];
+    for (size_t i = 0; i < TEXT_CACHE_SIZE; i++) {
+        text_cache_entry_t* e = &text->cache[i];
+        if (e->texture != NULL && strcmp(e->text, str) == 0) {
+            entry = e;
+            break;
+        }
+        if (victim->texture != NULL && (e->texture == NULL || e->last_used < victim->last_used)) {
+            victim = e;
+        }
+    }
+
+    if (entry != NULL) {
+        text->stats.cache_hits++;
+    } else {
+        text->stats.cache_misses++;
+        if (victim->texture != NULL) {
+            SDL_DestroyTexture(victim->texture);
+            victim->texture = NULL;
+            text->stats.cache_evictions++;
+        }
+        // strings are rendered in white and tinted at draw time, so the color is not part of the key
+        SDL_Surface* surface = TTF_RenderText_Blended(text->font, str, GLYPH_COLOR);
+        if (surface == NULL) {
+            fprintf(stderr, "Failed to create surface for font! %s\n", SDL_GetError());
+            return;
+        }
+        SDL_Texture* tex = SDL_CreateTextureFromSurface(renderer, surface);
+        SDL_FreeSurface(surface);
+        if (tex == NULL) {
+            fprintf(stderr, "Failed to create texture from surface! %s\n", SDL_GetError());
+            return;
+        }
+        entry = victim;
+        entry->texture = tex;
+        strcpy(entry->text, str);
+        SDL_QueryTexture(tex, NULL, NULL, &entry->width, &entry->height);
+    }
+    entry->last_used = text->clock;
+
+    SDL_Rect dst = { .x = x, .y = y, .w = entry->width, .h = entry->height };
+    SDL_SetTextureColorMod(entry->texture, color.r, color.g, color.b);
+    SDL_RenderCopy(renderer, entry->texture, NULL, &dst);
+}
+
+static glyph_t* text_glyph(text_t* text, char c)
+{
+    unsigned char ch = (unsigned char)c;
+    if (ch < TEXT_FIRST_GLYPH || ch > TEXT_LAST_GLYPH) {
+        text->stats.atlas_misses++;
+        ch = '?';
+    } else {
+        text->stats.atlas_hits++;
+    }
+    return &text->glyphs[ch - TEXT_FIRST_GLYPH];
+}
+
+// A glyph that fails to rasterize keeps an empty rect and is skipped when drawing.
+static void text_font_rasterize(text_font_t* font, int index)
+{
+    Uint16 ch = (Uint16)(TEXT_FIRST_GLYPH + index);
+    glyph_t* glyph = &font->glyphs[index];
+    glyph->atlas_rect.x = (index % TEXT_ATLAS_COLUMNS) * font->cell_width;
+    glyph->atlas_rect.y = (index / TEXT_ATLAS_COLUMNS) * font->cell_height;
+    if (TTF_GlyphMetrics(font->font, ch, NULL, NULL, NULL, NULL, &glyph->advance) != 0) {
+        glyph->advance = 0;
+    }
+
+    SDL_Surface* rendered = TTF_RenderGlyph_Blended(font->font, ch, GLYPH_COLOR);
+    if (rendered == NULL) {
+        fprintf(stderr, "Failed to render glyph '%c'! %s\n", ch, SDL_GetError());
+        return;
+    }
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+    SDL_FreeSurface(rendered);
+    if (surface == NULL) {
+        fprintf(stderr, "Failed to convert glyph surface! %s\n", SDL_GetError());
+        return;
+    }
+
+    glyph->atlas_rect.w = surface->w < font->cell_width ? surface->w : font->cell_width;
+    glyph->atlas_rect.h = surface->h < font->cell_height ? surface->h : font->cell_height;
+    for (int row = 0; row < glyph->atlas_rect.h; row++) {
+        Uint32* dst = font->pixels + (size_t)(glyph->atlas_rect.y + row) * font->atlas_width + glyph->atlas_rect.x;
+        memcpy(dst, (const char*)surface->pixels + (size_t)row * surface->pitch, sizeof(Uint32) * glyph->atlas_rect.w);
+    }
+    SDL_FreeSurface(surface);
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#ifndef BRICKS_TEXT_H
+#define BRICKS_TEXT_H
+
+#include "types.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#define TEXT_FIRST_GLYPH 32
+#define TEXT_LAST_GLYPH 126
+#define TEXT_GLYPH_COUNT (TEXT_LAST_GLYPH - TEXT_FIRST_GLYPH + 1)
+#define TEXT_ATLAS_COLUMNS 16
+#define TEXT_CACHE_SIZE 16
+#define TEXT_CACHE_MAX_LENGTH 64
+
+typedef struct glyph {
+    SDL_Rect atlas_rect;
+    int advance;
+} glyph_t;
+
+// A whole string rendered to its own texture, used for HUD text that rarely changes.
+typedef struct text_cache_entry {
+    char text[TEXT_CACHE_MAX_LENGTH];
+    SDL_Texture* texture;
+    int width, height;
+    unsigned long last_used;
+} text_cache_entry_t;
+
+typedef struct text_stats {
+    unsigned long atlas_hits;
+    unsigned long atlas_misses; // characters outside of the atlas, drawn as '?'
+    unsigned long atlas_uploads;
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+    unsigned long cache_evictions;
+} text_stats_t;
+
+// Everything a text_t needs that doesn't involve the renderer: the font and the glyph atlas,
+// rasterized into memory. It can be loaded on any thread.
+typedef struct text_font {
+    TTF_Font* font;
+    int cell_width, cell_height;
+    int atlas_width, atlas_height;
+    Uint32* pixels; // ARGB8888
+    glyph_t glyphs[TEXT_GLYPH_COUNT];
+} text_font_t;
+
+typedef struct text {
+    TTF_Font* font;
+    SDL_Texture* atlas;
+    int cell_width, cell_height;
+    glyph_t glyphs[TEXT_GLYPH_COUNT];
+    text_cache_entry_t cache[TEXT_CACHE_SIZE];
+    unsigned long clock;
+    text_stats_t stats;
+} text_t;
+
+// TTF_Init must have been called.
+text_font_t* text_font_load(const char* font_filename, int font_size);
+// Loads the font from the stream and closes it, for fonts that are already in memory.
+text_font_t* text_font_load_rw(SDL_RWops* rw, int font_size);
+void text_font_destroy(text_font_t* font);
+
+text_t* text_create(SDL_Renderer* renderer, const char* font_filename, int font_size);
+// Uploads the atlas of a loaded font; the text takes the font over, even when this fails.
+text_t* text_create_from_font(SDL_Renderer* renderer, text_font_t* font);
+void text_destroy(text_t* text);
+
+// Lays the string out glyph by glyph from the atlas.
+void text_draw(text_t* text, SDL_Renderer* renderer, const char* str, int x, int y, color_t color);
+// Draws the string from the LRU cache of whole-string textures, rendering it on a miss.
+void text_draw_cached(text_t* text, SDL_Renderer* renderer, const char* str, int x, int y, color_t color);
+
+#endif //BRICKS_TEXT_H
@@ -0,0 +1,73 @@
+// Copyright (c) 2021, Patrick Wilmes <patrick.wilmes@bit-lake.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include "timestep.h"
+#include <malloc.h>
+#include <stddef.h>
+
+// frames longer than this (breakpoints, window drags) don't try to catch up on the lost time
+#define MAX_FRAME_SECONDS 0.25
+#define MAX_TICKS_PER_FRAME 8
+
+timestep_t* timestep_create(int tick_rate)
+{
+    timestep_t* timestep = malloc(sizeof(timestep_t));
+    timestep->tick_seconds = 1.0 / tick_rate;
+    timestep->accumulator = 0;
+    timestep->max_frame_seconds = MAX_FRAME_SECONDS;
+    timestep->max_ticks_per_frame = MAX_TICKS_PER_FRAME;
+    return timestep;
+}
+
+void timestep_destroy(timestep_t* timestep)
+{
+    if (timestep == NULL)
+        return;
+    free(timestep);
+}
+
+int timestep_advance(timestep_t* timestep, double frame_seconds)
+{
+    if (frame_seconds > timestep->max_frame_seconds) {
+        frame_seconds = timestep->max_frame_seconds;
+    }
+    if (frame_seconds < 0) {
+        frame_seconds = 0;
+    }
+    timestep->accumulator += frame_seconds;
+    int ticks = 0;
+    while (timestep->accumulator >= timestep->tick_seconds && ticks < timestep->max_ticks_per_frame) {
+        timestep->accumulator -= timestep->tick_seconds;
+        ticks++;
+    }
+    // when the simulation can't keep up, drop the backlog instead of spiraling
+    if (timestep->accumulator >= timestep->tick_seconds) {
+        timestep->accumulator = timestep->tick_seconds * 0.999;
+    }
+    return ticks;
+}
+
+double timestep_alpha(const timestep_t* timestep)
+{
+    return timestep->accumulator / timestep->tick_seconds;
+}